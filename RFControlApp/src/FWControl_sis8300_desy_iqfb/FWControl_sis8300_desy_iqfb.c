@@ -10,12 +10,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 #include "FWControl_sis8300_desy_iqfb.h"
 
 /*======================================
  * Private Data and Routines
  *======================================*/     
+/**
+ * Lock a buffer into the RAM and touch every page, so that the DMA of the DAQ data never hits a page fault
+ *   in the real-time loop. The lock is kept also if the IOC does not lock all its memory
+ */
+static void FWC_sis8300_desy_iqfb_func_lockBuffer(void *addr, size_t len)
+{
+    size_t i;
+    volatile char *var_p = (volatile char *)addr;
+
+    if(!addr || len == 0) return;
+
+#ifdef __linux__
+    if(mlock(addr, len) != 0)
+        EPICSLIB_func_errlogPrintf("FWC_sis8300_desy_iqfb_func_lockBuffer: mlock of %lu bytes failed (%s)\n", (unsigned long)len, strerror(errno));
+#endif
+
+    for(i = 0; i < len; i += FWC_SIS8300_DESY_IQFB_CONST_PAGE_SIZE)
+        __sync_fetch_and_add(var_p + i, 0);
+
+    __sync_fetch_and_add(var_p + len - 1, 0);
+}
+
 /**
  * Get a single channel from the DAQ system, the chId can be any value between 0 - 2 * FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_NUM (please note that
  * the channel here are defined for 16bit data, while the buffer in FPGA are defined for 32 bit data!)
@@ -79,6 +106,15 @@ int FWC_sis8300_desy_iqfb_func_init(void *module)
     /* Clean all data */
     memset(module, 0, sizeof(FWC_sis8300_desy_iqfb_struc_data));
 
+    /* Init the 3 copies of the DAQ buffer */
+    arg -> board_DAQBufWrite   = 0;
+    arg -> board_DAQBufCur     = 1;
+    arg -> board_DAQBufReady   = 1;
+    arg -> board_DAQBufRead    = 2;
+
+    /* Lock the DAQ buffers */
+    FWC_sis8300_desy_iqfb_func_lockBuffer((void *)arg -> board_bufDAQ, sizeof(arg -> board_bufDAQ));
+
     /* Init the local waveforms */
     RFLIB_initRFWaveform(&arg -> rfData_DACOut,        FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_DEPTH);
     
@@ -134,7 +170,12 @@ int FWC_sis8300_desy_iqfb_func_getDAQData(void *module)
 
     if(!arg) return -1;
 
-    FWC_sis8300_desy_iqfb_func_getAllDAQData(arg -> board_handle, arg -> board_bufDAQ);
+    FWC_sis8300_desy_iqfb_func_getAllDAQData(arg -> board_handle, arg -> board_bufDAQ[arg -> board_DAQBufWrite]);
+
+    /* publish the new copy and take the free one for the next pulse, the diagnostics may still read the older copy */
+    arg -> board_DAQBufCur   = arg -> board_DAQBufWrite;
+    __sync_synchronize();
+    arg -> board_DAQBufWrite = __sync_lock_test_and_set(&arg -> board_DAQBufReady, arg -> board_DAQBufWrite | FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH) & ~FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH;
     
     return 0;
 }
@@ -149,7 +190,7 @@ int FWC_sis8300_desy_iqfb_func_getADCData(void *module, unsigned long channel, s
     if(!arg || !data || channel > 9) return -1;
 
     /* get data */
-    FWC_sis8300_desy_iqfb_func_getDAQSingleChannel(arg -> board_bufDAQ, (int)channel, data);
+    FWC_sis8300_desy_iqfb_func_getDAQSingleChannel(arg -> board_bufDAQ[arg -> board_DAQBufCur], (int)channel, data);
 
     *sampleFreq_MHz = arg -> board_sampleFreq_MHz;
     *sampleDelay_ns = arg -> board_DAQTriggerDelay_ns;
@@ -160,33 +201,43 @@ int FWC_sis8300_desy_iqfb_func_getADCData(void *module, unsigned long channel, s
 }
 
 /**
- * Get the internal waveforms
+ * Get the internal waveforms of the latest pulse read by getDAQData, can be called by another thread
  */
 int FWC_sis8300_desy_iqfb_func_getIntData(void *module)
 {
     int status = 0;
+    unsigned int *ptr_bufDAQ;
 
     FWC_sis8300_desy_iqfb_struc_data *arg = (FWC_sis8300_desy_iqfb_struc_data *)module;
 
     /* check the input */
     if(!arg) return -1;
 
+    /* nothing new since the last call */
+    if(!(arg -> board_DAQBufReady & FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH)) return 0;
+
+    /* take the latest complete copy, getDAQData keeps writing into the other one */
+    arg -> board_DAQBufRead = __sync_lock_test_and_set(&arg -> board_DAQBufReady, arg -> board_DAQBufRead) & ~FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH;
+    __sync_synchronize();
+
+    ptr_bufDAQ = arg -> board_bufDAQ[arg -> board_DAQBufRead];
+
     /* fill all waveforms */
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_DACOut.chId,        arg -> rfData_DACOut.wfI,        arg -> rfData_DACOut.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_DACOut.chId,        arg -> rfData_DACOut.wfI,        arg -> rfData_DACOut.wfQ);
 
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_refCh.chId,         arg -> rfData_refCh.wfI,         arg -> rfData_refCh.wfQ);
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_fbkCh.chId,         arg -> rfData_fbkCh.wfI,         arg -> rfData_fbkCh.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_refCh.chId,         arg -> rfData_refCh.wfI,         arg -> rfData_refCh.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_fbkCh.chId,         arg -> rfData_fbkCh.wfI,         arg -> rfData_fbkCh.wfQ);
 
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_refCh_rotated.chId, arg -> rfData_refCh_rotated.wfI, arg -> rfData_refCh_rotated.wfQ);
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_fbkCh_rotated.chId, arg -> rfData_fbkCh_rotated.wfI, arg -> rfData_fbkCh_rotated.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_refCh_rotated.chId, arg -> rfData_refCh_rotated.wfI, arg -> rfData_refCh_rotated.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_fbkCh_rotated.chId, arg -> rfData_fbkCh_rotated.wfI, arg -> rfData_fbkCh_rotated.wfQ);
 
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_tracked.chId,       arg -> rfData_tracked.wfI,       arg -> rfData_tracked.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_tracked.chId,       arg -> rfData_tracked.wfI,       arg -> rfData_tracked.wfQ);
 
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_err.chId,           arg -> rfData_err.wfI,           arg -> rfData_err.wfQ);
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_err_acc.chId,       arg -> rfData_err_acc.wfI,       arg -> rfData_err_acc.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_err.chId,           arg -> rfData_err.wfI,           arg -> rfData_err.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_err_acc.chId,       arg -> rfData_err_acc.wfI,       arg -> rfData_err_acc.wfQ);
 
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_act.chId,           arg -> rfData_act.wfI,           arg -> rfData_act.wfQ);
-    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_act_rotated.chId,   arg -> rfData_act_rotated.wfI,   arg -> rfData_act_rotated.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_act.chId,           arg -> rfData_act.wfI,           arg -> rfData_act.wfQ);
+    status += FWC_sis8300_desy_iqfb_func_getDAQDoubleChannel(ptr_bufDAQ, (int)arg -> rfData_act_rotated.chId,   arg -> rfData_act_rotated.wfI,   arg -> rfData_act_rotated.wfQ);
 
     return status;
 }
@@ -18,6 +18,11 @@
 
 #include "FWControl_sis8300_desy_iqfb_board.h"
 
+#define FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_COPY_NUM    3       /* copies of the DAQ buffer, the DAQ data is written by the RF control thread and read by the diagnostics */
+#define FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH       0x4     /* flag of board_DAQBufReady, the buffer is not taken by the reader yet */
+
+#define FWC_SIS8300_DESY_IQFB_CONST_PAGE_SIZE           4096    /* memory page size, for touching the locked buffers */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -124,7 +129,11 @@ typedef struct {
     
     unsigned int board_bufWriteTable[FWC_SIS8300_DESY_IQFB_CONST_TAB_BUF_DEPTH];                      /* buffer for writing data to FPGA */
 
-    unsigned int board_bufDAQ[FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_DEPTH * FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_NUM];     /* buffer for all DAQ data */
+    unsigned int board_bufDAQ[FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_COPY_NUM][FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_DEPTH * FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_NUM];     /* buffers for all DAQ data (triple buffering) */
+    long          board_DAQBufWrite;                        /* copy being written by getDAQData */
+    long          board_DAQBufCur;                          /* copy last written by getDAQData, read by getADCData in the same thread */
+    volatile long board_DAQBufReady;                        /* last complete copy, with FWC_SIS8300_DESY_IQFB_CONST_DAQ_BUF_FRESH if not taken yet */
+    long          board_DAQBufRead;                         /* copy being read by getIntData */
 
     /* --- data for RF controller intermediate display --- */ 
     RFLIB_struc_RFWaveform rfData_DACOut;                   /* DAC ouput data */
@@ -14,12 +14,44 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#if defined(__SSE2__)                                       /* baseline of x86_64 */
+#include <emmintrin.h>
+#define FWC_SIS8300_STRUCK_IQFB_DEINT_X86
+#endif
 
 #include "FWControl_sis8300_struck_iqfb.h"
 
 /*======================================
  * Private Data and Routines 
  *======================================*/   
+/**
+ * Lock a buffer into the RAM and touch every page, so that the DMA of the ADC and DAQ data never hits a page
+ *   fault in the real-time loop. The lock is kept also if the IOC does not lock all its memory
+ */
+static void FWC_sis8300_struck_iqfb_func_lockBuffer(void *addr, size_t len)
+{
+    size_t i;
+    volatile char *var_p = (volatile char *)addr;
+
+    if(!addr || len == 0) return;
+
+#ifdef __linux__
+    if(mlock(addr, len) != 0)
+        EPICSLIB_func_errlogPrintf("FWC_sis8300_struck_iqfb_func_lockBuffer: mlock of %lu bytes failed (%s)\n", (unsigned long)len, strerror(errno));
+#endif
+
+    for(i = 0; i < len; i += FWC_SIS8300_STRUCK_IQFB_CONST_PAGE_SIZE)
+        __sync_fetch_and_add(var_p + i, 0);
+
+    __sync_fetch_and_add(var_p + len - 1, 0);
+}
+
 /**
  * Get the DAQ data. Interpret the raw data read from the hardware to meaningful channels.
  * The Struck firmware provide 64 bits DAQ data bus, the data format read to a short array is like this:
@@ -28,63 +60,183 @@
  *      16 bit data 2:  DAQ channel 1
  *      16 bit data 3:  DAQ channel 0
  *      ...
- * Get a single channel from the DAQ system, the chId can be any value between 0 - 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM (please note that
- * the channel here are defined for 16bit data, while the buffer in FPGA are defined for 64 bit data!)
+ * All DAQ buffers are unpacked in one pass into the channels (channel chId of the DAQ system is ch[chId],
+ * 0 - 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM - 1, please note that the channel here are defined
+ * for 16bit data, while the buffer in FPGA are defined for 64 bit data!). With SSE2, 8 words are
+ * transposed per step by the 16/32/64 bits unpack instructions, the rest is done by the scalar code
  */
-static int FWC_sis8300_struck_iqfb_func_getDAQSingleChannel(unsigned int *DAQData, int chId, short *data)
+static void FWC_sis8300_struck_iqfb_func_deinterleaveDAQ(const unsigned int *DAQData, short (*ch)[FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH])
 {
-    int status = 0;
-    int var_bufId;
-    unsigned int *dataStart;                                     /* location of the data */
-    short *dataStart_short;                                      /* make the location to short */
+    const short *dataStart_short;                               /* 4 shorts per 64 bit word */
+    short *ptr_ch0, *ptr_ch1, *ptr_ch2, *ptr_ch3;
+    int    var_bufId;
+    int    i;
+
+#ifdef FWC_SIS8300_STRUCK_IQFB_DEINT_X86
+    __m128i a, b, c, d;
+    __m128i u0, u1, v0, v1, w0, w1;
+#endif
+
+    for(var_bufId = 0; var_bufId < FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM; var_bufId ++) {
+        dataStart_short = (const short *)(DAQData + var_bufId * 2 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH);
+
+        ptr_ch0 = ch[4 * var_bufId];
+        ptr_ch1 = ch[4 * var_bufId + 1];
+        ptr_ch2 = ch[4 * var_bufId + 2];
+        ptr_ch3 = ch[4 * var_bufId + 3];
+
+        i = 0;
+
+#ifdef FWC_SIS8300_STRUCK_IQFB_DEINT_X86
+        for(; i + 8 <= FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH; i += 8) {
+            a  = _mm_loadu_si128((const __m128i *)(dataStart_short + 4 * i));          /* 3 2 1 0 3 2 1 0 of words i, i+1 */
+            b  = _mm_loadu_si128((const __m128i *)(dataStart_short + 4 * i + 8));
+            c  = _mm_loadu_si128((const __m128i *)(dataStart_short + 4 * i + 16));
+            d  = _mm_loadu_si128((const __m128i *)(dataStart_short + 4 * i + 24));
+
+            u0 = _mm_unpacklo_epi16(a, b);
+            u1 = _mm_unpackhi_epi16(a, b);
+            v0 = _mm_unpacklo_epi16(u0, u1);                                            /* channel 3 and 2 of words i - i+3 */
+            v1 = _mm_unpackhi_epi16(u0, u1);                                            /* channel 1 and 0 of words i - i+3 */
+
+            u0 = _mm_unpacklo_epi16(c, d);
+            u1 = _mm_unpackhi_epi16(c, d);
+            w0 = _mm_unpacklo_epi16(u0, u1);
+            w1 = _mm_unpackhi_epi16(u0, u1);
+
+            _mm_storeu_si128((__m128i *)(ptr_ch3 + i), _mm_unpacklo_epi64(v0, w0));
+            _mm_storeu_si128((__m128i *)(ptr_ch2 + i), _mm_unpackhi_epi64(v0, w0));
+            _mm_storeu_si128((__m128i *)(ptr_ch1 + i), _mm_unpacklo_epi64(v1, w1));
+            _mm_storeu_si128((__m128i *)(ptr_ch0 + i), _mm_unpackhi_epi64(v1, w1));
+        }
+#endif
 
-    int idOffset[4] = {3, 2, 1, 0};
+        for(; i < FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH; i ++) {
+            ptr_ch3[i] = dataStart_short[4 * i];
+            ptr_ch2[i] = dataStart_short[4 * i + 1];
+            ptr_ch1[i] = dataStart_short[4 * i + 2];
+            ptr_ch0[i] = dataStart_short[4 * i + 3];
+        }
+    }
+}
 
+/**
+ * Get a single channel from the deinterleaved DAQ data
+ */
+static int FWC_sis8300_struck_iqfb_func_getDAQSingleChannel(short (*ch)[FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH], int chId, short *data)
+{
     /* check the input */
-    if(!DAQData || !data) return -1;
+    if(!ch || !data) return -1;
 
-    /* Find the location of the data in the DAQ buffer (every 4 channels are mixed!) */
-    var_bufId       = (int)(chId / 4);
-    dataStart       = DAQData + var_bufId * 2 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH;
-    dataStart_short = (short *)dataStart;
-
-    /* Check the buffer number, must be smaller than the maximum number */
-    if(var_bufId >= FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM) return -1;
+    /* Check the channel number, must be smaller than the maximum number */
+    if(chId < 0 || chId >= 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM) return -1;
 
     /* Get the data */
-    status = MATHLIB_getEveryNSubArray(dataStart_short, 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH, data, idOffset[chId - 4 * var_bufId], 4);
+    memcpy((void *)data, (void *)ch[chId], sizeof(short) * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH);
 
-    return status;
+    return 0;
 }
 
 /**
  * Get the two channel at the same time, the chId must be 0,2,4,...
  */
-static int FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(unsigned int *DAQData, int chId, short *dataHi, short *dataLo)
+static int FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(short (*ch)[FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH], int chId, short *dataHi, short *dataLo)
 {
     int status = 0;
-    int var_bufId;
-    unsigned int *dataStart;                                     /* location of the data */
-    short *dataStart_short;                                      /* make the location to short */
 
-    int idOffset[4] = {3, 2, 1, 0};
+    status += FWC_sis8300_struck_iqfb_func_getDAQSingleChannel(ch, chId,     dataHi);
+    status += FWC_sis8300_struck_iqfb_func_getDAQSingleChannel(ch, chId + 1, dataLo);
 
-    /* check the input */
-    if(!DAQData || !dataHi || !dataLo) return -1;
+    return status;
+}
+                   
+/**
+ * Mark a channel of the current pulse as read and wake up the reader waiting for it
+ */
+static void FWC_sis8300_struck_iqfb_func_signalADCChannel(FWC_sis8300_struck_iqfb_struc_data *arg, unsigned int ch)
+{
+    __sync_synchronize();                                   /* the data must be visible before the flag */
+    arg -> board_ADCDone[ch] = 1;
 
-    /* Find the location of the data in the DAQ buffer (every 4 channels are mixed!) */
-    var_bufId       = (int)(chId / 4);
-    dataStart       = DAQData + var_bufId * 2 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH;
-    dataStart_short = (short *)dataStart;
+    if(arg -> board_ADCFence[ch]) epicsEventSignal(arg -> board_ADCFence[ch]);
+}
 
-    /* Check the buffer number, must be smaller than the maximum number */
-    if(var_bufId >= FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM) return -1;
+/**
+ * Wait until a channel of the current pulse is read. Return immediately if the data is read synchronously
+ */
+static int FWC_sis8300_struck_iqfb_func_waitADCChannel(FWC_sis8300_struck_iqfb_struc_data *arg, unsigned long ch)
+{
+    while(!arg -> board_ADCDone[ch]) {
+        if(!arg -> board_ADCFence[ch]) return -1;
 
-    /* Get the data */
-    status += MATHLIB_getEveryNSubArray(dataStart_short, 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH, dataHi, idOffset[chId - 4 * var_bufId],     4);
-    status += MATHLIB_getEveryNSubArray(dataStart_short, 4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH, dataLo, idOffset[chId - 4 * var_bufId + 1], 4);
+        /* the event may be left from a pulse not waited for, so check the flag again */
+        if(epicsEventWaitWithTimeout(arg -> board_ADCFence[ch], FWC_SIS8300_STRUCK_IQFB_CONST_ADC_FENCE_TIMEOUT) != epicsEventWaitOK && !arg -> board_ADCDone[ch]) 
+            return -1;
+    }
 
-    return status;
+    __sync_synchronize();                                   /* the data must be read after the flag */
+
+    return 0;
+}
+
+/**
+ * Wait until the helper thread completes the last pulse
+ */
+static int FWC_sis8300_struck_iqfb_func_waitADCJob(FWC_sis8300_struck_iqfb_struc_data *arg)
+{
+    while(arg -> board_ADCJobBusy) {
+        if(epicsEventWaitWithTimeout(arg -> board_ADCJobDoneEvent, FWC_SIS8300_STRUCK_IQFB_CONST_ADC_FENCE_TIMEOUT) != epicsEventWaitOK && arg -> board_ADCJobBusy) 
+            return -1;
+    }
+
+    __sync_synchronize();
+
+    return 0;
+}
+
+/**
+ * Helper thread reading the ADC data from the DRAM. The channels in the priority mask are read first, each channel is
+ * signaled when it is read so that the reader can process it while the next channel is transferred. The sampling
+ * is re-armed after all channels are read
+ */
+static void FWC_sis8300_struck_iqfb_func_ADCThread(void *module)
+{
+    FWC_sis8300_struck_iqfb_struc_data *arg = (FWC_sis8300_struck_iqfb_struc_data *)module;
+
+    unsigned int var_order[10];
+    unsigned int ch;
+    int          var_num;
+    int          i;
+
+    while(1) {
+        epicsEventWait(arg -> board_ADCJobEvent);
+
+        if(!arg -> board_ADCJobBusy) continue;
+
+        __sync_synchronize();                               /* the job settings must be read after the state */
+
+        /* the priority channels first */
+        var_num = 0;
+        for(ch = 0; ch < 10; ch ++) if(arg -> board_ADCJobPrioChMask & (1U << ch))    var_order[var_num ++] = ch;
+        for(ch = 0; ch < 10; ch ++) if(!(arg -> board_ADCJobPrioChMask & (1U << ch))) var_order[var_num ++] = ch;
+
+        for(i = 0; i < 10; i ++) {
+            ch = var_order[i];
+
+            if(arg -> board_ADCJobChMask & (1U << ch))
+                FWC_sis8300_struck_iqfb_func_getADCChannel(arg -> board_handle, arg -> board_ADCJobPno, ch, arg -> board_ADCJobStart, arg -> board_ADCJobReadPno, arg -> board_ADC_data[ch]);
+
+            FWC_sis8300_struck_iqfb_func_signalADCChannel(arg, ch);
+        }
+
+        /* re-arm the sampling, waiting for next trigger */
+        FWC_sis8300_struck_iqfb_func_armADC(arg -> board_handle, arg -> board_ADCJobPno);
+
+        __sync_synchronize();
+        arg -> board_ADCJobBusy = 0;
+
+        epicsEventSignal(arg -> board_ADCJobDoneEvent);
+    }
 }
                    
 /*======================================
@@ -97,6 +249,8 @@ int FWC_sis8300_struck_iqfb_func_init(void *module)
 {    
     FWC_sis8300_struck_iqfb_struc_data *arg = (FWC_sis8300_struck_iqfb_struc_data *)module;
 
+    int i;
+
     /* check input */
     if(!arg) return -1;
 
@@ -134,6 +288,20 @@ int FWC_sis8300_struck_iqfb_func_init(void *module)
     arg -> board_ADC_data[8] = arg -> board_ADC8_raw;
     arg -> board_ADC_data[9] = arg -> board_ADC9_raw;    
 
+    for(i = 0; i < 10; i ++) arg -> board_ADCDone[i] = 1;       /* no pulse is being read */
+
+    arg -> board_DAQBufWrite   = 0;                             /* the 3 copies of the DAQ buffer */
+    arg -> board_DAQBufReady   = 1;
+    arg -> board_DAQBufRead    = 2;
+
+    arg -> board_ADCReadChMask = 0x3FF;                         /* read all points of all ADCs */
+    arg -> board_ADCReadStart  = 0;
+    arg -> board_ADCReadPno    = 0;
+    arg -> board_ADCChMaskCur  = 0x3FF;
+
+    /* Lock the DAQ buffers and the ADC raw data (they are contiguous in the structure) */
+    FWC_sis8300_struck_iqfb_func_lockBuffer((void *)arg -> board_bufDAQ, (size_t)((char *)(arg -> board_ADC9_raw + FWC_SIS8300_STRUCK_IQFB_CONST_ADC_SAMPLE_MAX) - (char *)arg -> board_bufDAQ));
+
     return 0;       
 }
 
@@ -151,6 +319,45 @@ int FWC_sis8300_struck_iqfb_func_assBoard(void *module, void *boardHandle)
     return 0;
 }
 
+/**
+ * Create the helper thread for the asynchronous reading of the ADC data, not in the real-time path
+ */
+int FWC_sis8300_struck_iqfb_func_initADCThread(void *module)
+{
+    FWC_sis8300_struck_iqfb_struc_data *arg = (FWC_sis8300_struck_iqfb_struc_data *)module;
+
+    char  var_threadName[EPICSLIB_CONST_NAME_LEN + 8];
+    char *ptr_name;
+    int   i;
+
+    if(!arg) return -1;
+
+    if(arg -> board_ADCThreadReady) return 0;
+
+    if(!arg -> board_ADCJobEvent)     arg -> board_ADCJobEvent     = epicsEventCreate(epicsEventEmpty);
+    if(!arg -> board_ADCJobDoneEvent) arg -> board_ADCJobDoneEvent = epicsEventCreate(epicsEventEmpty);
+    if(!arg -> board_ADCJobEvent || !arg -> board_ADCJobDoneEvent) return -1;
+
+    for(i = 0; i < 10; i ++) {
+        if(!arg -> board_ADCFence[i]) arg -> board_ADCFence[i] = epicsEventCreate(epicsEventEmpty);
+        if(!arg -> board_ADCFence[i]) return -1;
+    }
+
+    ptr_name = strrchr(arg -> board_deviceName, '/');                   /* "/dev/sis8300-0" to "sis8300-0" */
+    ptr_name = ptr_name ? ptr_name + 1 : arg -> board_deviceName;
+    sprintf(var_threadName, "%s_ADC", ptr_name);
+
+    /* the priority is raised to the one of the RF control thread by getDAQData */
+    arg -> board_ADCThreadPriority = epicsThreadGetPrioritySelf();
+    arg -> board_ADCThread = EPICSLIB_func_threadCreate(var_threadName, arg -> board_ADCThreadPriority, FWC_sis8300_struck_iqfb_func_ADCThread, (void *)arg);
+    if(!arg -> board_ADCThread) return -1;
+
+    __sync_synchronize();
+    arg -> board_ADCThreadReady = 1;
+
+    return 0;
+}
+
 /**
  * Get the maximum sample number supported
  */
@@ -171,46 +378,67 @@ int FWC_sis8300_struck_iqfb_func_getDAQData(void *module)
     FWC_sis8300_struck_iqfb_struc_data *arg = (FWC_sis8300_struck_iqfb_struc_data *)module;
 
     unsigned int coefId;
+    unsigned int var_priority;
+    int    i;
 
     if(!arg) return -1;
 
     if(arg -> board_handle) {
-        /* get the BRAM data (RF Controller internal) */
-        FWC_sis8300_struck_iqfb_func_getAllDAQData(arg -> board_handle, arg -> board_bufDAQ);
-
-        /* get the DRAM data (ADC raw) */
-        FWC_sis8300_struck_iqfb_func_getAllADCData(arg -> board_handle, (unsigned int)arg -> board_ADCSamplePno, 
-                                                   arg -> board_ADC0_raw, arg -> board_ADC1_raw,
-                                                   arg -> board_ADC2_raw, arg -> board_ADC3_raw,
-                                                   arg -> board_ADC4_raw, arg -> board_ADC5_raw,
-                                                   arg -> board_ADC6_raw, arg -> board_ADC7_raw,
-                                                   arg -> board_ADC8_raw, arg -> board_ADC9_raw); 
+        /* the helper thread should have completed the last pulse long ago */
+        if(FWC_sis8300_struck_iqfb_func_waitADCJob(arg) != 0) return -1;
+
+        /* get the BRAM data (RF Controller internal) to a free copy, then make it the latest one. getIntData may be 
+           called later by a lower priority thread, so the copy being read there is never touched */
+        FWC_sis8300_struck_iqfb_func_getAllDAQData(arg -> board_handle, arg -> board_bufDAQ[arg -> board_DAQBufWrite]);
+
+        __sync_synchronize();
+        arg -> board_DAQBufWrite = __sync_lock_test_and_set(&arg -> board_DAQBufReady, arg -> board_DAQBufWrite | FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH) & ~FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH;
+
+        /* get the DRAM data (ADC raw), the readers have copied the data of the last pulse before this call */
+        for(i = 0; i < 10; i ++) arg -> board_ADCDone[i] = 0;
+        arg -> board_ADCChMaskCur = arg -> board_ADCReadChMask & 0x3FF;
+
+        if(arg -> board_ADCAsync && arg -> board_ADCThreadReady) {
+            /* the helper thread runs at the priority of the caller (RF control thread), which may be changed at run time */
+            var_priority = epicsThreadGetPrioritySelf();
+            if(var_priority != arg -> board_ADCThreadPriority) {
+                EPICSLIB_func_threadSetPriority(arg -> board_ADCThread, var_priority);
+                arg -> board_ADCThreadPriority = var_priority;
+            }
+
+            /* hand over to the helper thread, the readers wait for their channels */
+            arg -> board_ADCJobPno        = (unsigned int)arg -> board_ADCSamplePno;
+            arg -> board_ADCJobChMask     = (unsigned int)arg -> board_ADCChMaskCur;
+            arg -> board_ADCJobPrioChMask = (unsigned int)arg -> board_ADCPrioChMask;
+            arg -> board_ADCJobStart      = (unsigned int)arg -> board_ADCReadStart;
+            arg -> board_ADCJobReadPno    = (unsigned int)arg -> board_ADCReadPno;
+
+            __sync_synchronize();                                   /* the job settings must be visible before the state */
+            arg -> board_ADCJobBusy = 1;
+
+            epicsEventSignal(arg -> board_ADCJobEvent);
+        } else {
+            FWC_sis8300_struck_iqfb_func_getAllADCData(arg -> board_handle, (unsigned int)arg -> board_ADCSamplePno, 
+                                                       (unsigned int)arg -> board_ADCChMaskCur, (unsigned int)arg -> board_ADCReadStart, (unsigned int)arg -> board_ADCReadPno,
+                                                       arg -> board_ADC0_raw, arg -> board_ADC1_raw,
+                                                       arg -> board_ADC2_raw, arg -> board_ADC3_raw,
+                                                       arg -> board_ADC4_raw, arg -> board_ADC5_raw,
+                                                       arg -> board_ADC6_raw, arg -> board_ADC7_raw,
+                                                       arg -> board_ADC8_raw, arg -> board_ADC9_raw); 
+
+            for(i = 0; i < 10; i ++) arg -> board_ADCDone[i] = 1;
+        }
 
         /* get the current coefficient id for demod in CPU */
         FWC_sis8300_struck_iqfb_func_getNonIQCoefCur(arg -> board_handle, &coefId);
         arg -> board_coefIdCur = (long)coefId;
     }
 
-    /*int i;
-    int var_cnt;
-
-    var_cnt = 0;
-    
-    printf("-----------------------------------------------\n");
-    for(i = 0; i < 128; i ++) {
-        printf("0x%4X  ", *(arg -> board_ADC0_raw + i));
-        var_cnt ++;
-        if(var_cnt >= 8) {
-            var_cnt = 0;
-            printf("\n");
-        }
-    }*/
-
     return 0;
 }
 
 /**
- * Get ADC data (assume the ADC data is at channel 0-9 of the DAQ)
+ * Get ADC data (assume the ADC data is at channel 0-9 of the DAQ). Fail if the channel is not read for the current pulse
  */
 int FWC_sis8300_struck_iqfb_func_getADCData(void *module, unsigned long channel, short *data, double *sampleFreq_MHz, double *sampleDelay_ns, long *pno, long *coefIdCur)
 {
@@ -219,6 +447,9 @@ int FWC_sis8300_struck_iqfb_func_getADCData(void *module, unsigned long channel,
     if(!arg || !data || channel > 9 || !sampleFreq_MHz || !sampleDelay_ns || !pno || !coefIdCur) return -1;
 
     /* get data */
+    if(!(arg -> board_ADCChMaskCur & (1L << channel))) return -1;
+    if(FWC_sis8300_struck_iqfb_func_waitADCChannel(arg, channel) != 0) return -1;
+
     if(arg -> board_ADC_data[channel]) 
         memcpy((void *)data, (void *)arg -> board_ADC_data[channel], sizeof(short) * FWC_SIS8300_STRUCK_IQFB_CONST_APPDATA_BUF_DEPTH);
 
@@ -231,7 +462,7 @@ int FWC_sis8300_struck_iqfb_func_getADCData(void *module, unsigned long channel,
 }
 
 /**
- * Get the internal waveforms
+ * Get the internal waveforms of the latest pulse read by getDAQData, can be called by another thread
  */
 int FWC_sis8300_struck_iqfb_func_getIntData(void *module)
 {
@@ -242,16 +473,25 @@ int FWC_sis8300_struck_iqfb_func_getIntData(void *module)
     /* check the input */
     if(!arg) return -1;
 
+    /* nothing new since the last call */
+    if(!(arg -> board_DAQBufReady & FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH)) return 0;
+
+    /* take the latest copy and give back the one read last time */
+    arg -> board_DAQBufRead = __sync_lock_test_and_set(&arg -> board_DAQBufReady, arg -> board_DAQBufRead) & ~FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH;
+    __sync_synchronize();
+
     /* fill all waveforms */
     if(arg -> board_handle) {    
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_refCh.chId,         arg -> rfData_refCh.wfI,         arg -> rfData_refCh.wfQ);
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_fbkCh.chId,         arg -> rfData_fbkCh.wfI,         arg -> rfData_fbkCh.wfQ);
+        FWC_sis8300_struck_iqfb_func_deinterleaveDAQ(arg -> board_bufDAQ[arg -> board_DAQBufRead], arg -> board_DAQCh);   /* unpack all channels in one pass */
+
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_refCh.chId,         arg -> rfData_refCh.wfI,         arg -> rfData_refCh.wfQ);
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_fbkCh.chId,         arg -> rfData_fbkCh.wfI,         arg -> rfData_fbkCh.wfQ);
 
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_tracked.chId,       arg -> rfData_tracked.wfI,       arg -> rfData_tracked.wfQ);
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_err.chId,           arg -> rfData_err.wfI,           arg -> rfData_err.wfQ);
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_tracked.chId,       arg -> rfData_tracked.wfI,       arg -> rfData_tracked.wfQ);
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_err.chId,           arg -> rfData_err.wfI,           arg -> rfData_err.wfQ);
 
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_act.chId,           arg -> rfData_act.wfI,           arg -> rfData_act.wfQ);
-        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_bufDAQ, (int)arg -> rfData_DACOut.chId,        arg -> rfData_DACOut.wfI,        arg -> rfData_DACOut.wfQ);
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_act.chId,           arg -> rfData_act.wfI,           arg -> rfData_act.wfQ);
+        status += FWC_sis8300_struck_iqfb_func_getDAQDoubleChannel(arg -> board_DAQCh, (int)arg -> rfData_DACOut.chId,        arg -> rfData_DACOut.wfI,        arg -> rfData_DACOut.wfQ);
     }
 
     return status;
@@ -16,6 +16,9 @@
 #ifndef FW_CONTROL_SIS8300_STRUCK_IQFB_H
 #define FW_CONTROL_SIS8300_STRUCK_IQFB_H
 
+#include <epicsEvent.h>
+#include <epicsThread.h>
+
 #include "RFLib_signalProcess.h"                            /* use the library data definitions and routines */
 #include "MathLib_dataProcess.h"
 #include "EPICSLib_wrapper.h"
@@ -24,6 +27,13 @@
 
 #define FWC_SIS8300_STRUCK_IQFB_CONST_APPDATA_BUF_DEPTH 1024    /* the application part will use part of the ADC raw data, this is the number of point */
 
+#define FWC_SIS8300_STRUCK_IQFB_CONST_ADC_FENCE_TIMEOUT   0.1   /* maximum waiting time in s for the ADC data of a channel */
+
+#define FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_COPY_NUM    3     /* copies of the DAQ buffer, the DAQ data is written by the RF control thread and read by the diagnostics */
+#define FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH       0x4   /* flag of board_DAQBufReady, the buffer is not taken by the reader yet */
+
+#define FWC_SIS8300_STRUCK_IQFB_CONST_PAGE_SIZE           4096  /* memory page size, for touching the locked buffers */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -95,6 +105,27 @@ typedef struct {
     volatile long board_ampLimitLo;                         /* Limit of the DAC output low */
     
     volatile long board_ADCSamplePno;                       /* ADC sample point number */
+    volatile long board_ADCReadChMask;                      /* ADC channels read from the DRAM, bit n for ADC n */
+    volatile long board_ADCReadStart;                       /* first point read from the DRAM, aligned to 16 points */
+    volatile long board_ADCReadPno;                         /* point number read from the DRAM, 0 for all sampled points */
+    volatile long board_ADCChMaskCur;                       /* ADC channels read for the current pulse, the others have no data */
+
+    volatile long board_ADCAsync;                           /* 1 to read the ADC data in the helper thread, the readers wait for their channels */
+    volatile long board_ADCPrioChMask;                      /* ADC channels read first by the helper thread (e.g. the feedback channels) */
+
+    EPICSLIB_type_threadId board_ADCThread;                 /* helper thread reading the ADC data */
+    volatile long board_ADCThreadReady;                     /* 1 when the helper thread is ready */
+    unsigned int  board_ADCThreadPriority;                  /* priority of the helper thread, follows the thread getting the DAQ data */
+    epicsEventId  board_ADCJobEvent;                        /* start reading a pulse */
+    epicsEventId  board_ADCJobDoneEvent;                    /* all channels of the pulse are read and the sampling is re-armed */
+    epicsEventId  board_ADCFence[10];                       /* a channel of the pulse is read */
+    volatile long board_ADCDone[10];                        /* 1 when the channel of the current pulse is read */
+    volatile long board_ADCJobBusy;                         /* 1 while the helper thread is reading a pulse */
+    unsigned int  board_ADCJobPno;                          /* settings of the pulse being read */
+    unsigned int  board_ADCJobChMask;
+    unsigned int  board_ADCJobPrioChMask;
+    unsigned int  board_ADCJobStart;
+    unsigned int  board_ADCJobReadPno;
 
     volatile long board_coefIdOffset;                       /* the non-IQ coefficient ID offset, this is to compensate the sampling start point uncertainty after power cycle */
     volatile long board_coefIdCur;                          /* current coefficient Id for the first point of the DAQ buffer (ADC) */
@@ -148,7 +179,11 @@ typedef struct {
     double  board_drvRotScaleTable[FWC_SIS8300_STRUCK_IQFB_CONST_DRV_TAB_BUF_DEPTH];    /* driving chain rotation tables */
     double  board_drvRotAngleTable[FWC_SIS8300_STRUCK_IQFB_CONST_DRV_TAB_BUF_DEPTH];
 
-    unsigned int board_bufDAQ[FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM * 2];     /* buffer for all DAQ data */
+    unsigned int board_bufDAQ[FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_COPY_NUM][FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM * 2];     /* buffers for all DAQ data (triple buffering) */
+    long          board_DAQBufWrite;                        /* copy being written by getDAQData */
+    volatile long board_DAQBufReady;                        /* last complete copy, with FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_FRESH if not taken yet */
+    long          board_DAQBufRead;                         /* copy being read by getIntData */
+    short        board_DAQCh[4 * FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_NUM][FWC_SIS8300_STRUCK_IQFB_CONST_DAQ_BUF_DEPTH];     /* DAQ data of all channels, deinterleaved from board_bufDAQ */
 
     short board_ADC0_raw[FWC_SIS8300_STRUCK_IQFB_CONST_ADC_SAMPLE_MAX];      /* ADC raw data for display */
     short board_ADC1_raw[FWC_SIS8300_STRUCK_IQFB_CONST_ADC_SAMPLE_MAX];
@@ -188,6 +223,8 @@ int FWC_sis8300_struck_iqfb_func_assBoard(void *module, void *boardHandle);
 
 int FWC_sis8300_struck_iqfb_func_getMaxSampleNum(long *pno_max);
 
+int FWC_sis8300_struck_iqfb_func_initADCThread(void *module);
+
 int FWC_sis8300_struck_iqfb_func_getDAQData(void *module);
 int FWC_sis8300_struck_iqfb_func_getADCData(void *module, unsigned long channel, short *data, double *sampleFreq_MHz, double *sampleDelay_ns, long *pno, long *coefIdCur);
 int FWC_sis8300_struck_iqfb_func_getIntData(void *module);
@@ -1019,61 +1019,64 @@ void  FWC_sis8300_struck_iqfb_func_getAllDAQData(void *boardHandle, unsigned int
 }
 
 /**
- * Get the ADC data from the DRAM
+ * Get the ADC data of a channel from the DRAM
  * Note: now, all the ADC raw data will be read from the DRAM while the RF controller internal data will be read from the BRAM
  *       The DRAM data is still offset binary and the BRAM data is already 2's complement
  *       - Code copied from the test program provided by Struck
  *       - Address of the registers are defined in the RFCB module
  *
- *       The ADCxData is a temp buffer to convert the data format
+ *       The ADCData is a temp buffer to convert the data format
+ *
+ *       All pno points of the 10 ADCs are sampled, while only the window [readStart, readStart + readPno) (readPno 0 for all points)
+ *       is read. The window is extended to the 16 points blocks of the firmware and the data is placed at the same offset in the
+ *       ADCData, the other sampled points are cleared (they would hold the data of an older pulse otherwise)
  */
-void  FWC_sis8300_struck_iqfb_func_getAllADCData(void *boardHandle, unsigned int pno,
-                                                            short *ADC0Data, short *ADC1Data,            
-                                                            short *ADC2Data, short *ADC3Data,
-                                                            short *ADC4Data, short *ADC5Data,
-                                                            short *ADC6Data, short *ADC7Data,
-                                                            short *ADC8Data, short *ADC9Data)
+void  FWC_sis8300_struck_iqfb_func_getADCChannel(void *boardHandle, unsigned int pno, unsigned int ch, unsigned int readStart, unsigned int readPno, short *ADCData)
 {
     int i;
-    unsigned int data;
     unsigned int pno_f;
+    unsigned int start_f;
+    unsigned int end_f;
 
     /* check the input */
     pno_f = (unsigned int)(pno / 16) * 16;
     if(pno_f < 16) pno_f = 16;                      /* minimum point number is 16 and the number must be a integer time of 16 (limited by the firmware) */
 
-    if(!boardHandle || !ADC0Data || !ADC1Data || !ADC2Data || !ADC3Data || !ADC4Data || !ADC5Data || !ADC6Data || !ADC7Data || !ADC8Data || !ADC9Data) return;
+    if(!boardHandle || !ADCData || ch > 9) return;
 
-    /* wait if BUSY or arm (risky) */
-    /*do {
-        RFCB_API_readRegister((RFCB_struc_moduleData *)boardHandle, SIS8300_ACQUISITION_CONTROL_STATUS_REG, &data);       
-    } while((data & 0x3) != 0); */ /* assume time is enough for finishing the sampling */
+    /* the window to read, aligned to the blocks of 16 points */
+    start_f = (readStart / 16) * 16;
+    end_f   = (readPno == 0 || readStart + readPno > pno_f) ? pno_f : ((readStart + readPno + 15) / 16) * 16;
+    if(end_f > pno_f) end_f = pno_f;
+
+    if(start_f > end_f) start_f = end_f;
 
-    /* read the buffers (address and pno are for 32 bit data) */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 0 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC0Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 1 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC1Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 2 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC2Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 3 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC3Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 4 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC4Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 5 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC5Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 6 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC6Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 7 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC7Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 8 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC8Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
-    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, 9 * (0x100000 * 16 * 2 / 4), pno_f >> 1, (unsigned int *)ADC9Data);    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
+    /* clear the sampled points outside the window */
+    if(start_f > 0)     memset((void *)ADCData,           0, sizeof(short) * start_f);
+    if(end_f   < pno_f) memset((void *)(ADCData + end_f), 0, sizeof(short) * (pno_f - end_f));
+
+    if(start_f >= end_f) return;
+
+    /* read the buffer (address and pno are for 32 bit data) */
+    RFCB_API_readBuffer((RFCB_struc_moduleData *)boardHandle, ch * (0x100000 * 16 * 2 / 4) + (start_f >> 1), (end_f - start_f) >> 1, (unsigned int *)(ADCData + start_f));    /* Blocklength * 16 Samples/Block * 2Byte/Sample / 4 for 32 bits data */
 
     /* convert the data to 2's complement from binary offset */
-    for(i = 0; i < pno_f; i ++) {
-        *(ADC0Data + i) ^= 0x8000;
-        *(ADC1Data + i) ^= 0x8000;
-        *(ADC2Data + i) ^= 0x8000;
-        *(ADC3Data + i) ^= 0x8000;
-        *(ADC4Data + i) ^= 0x8000;
-        *(ADC5Data + i) ^= 0x8000;
-        *(ADC6Data + i) ^= 0x8000;
-        *(ADC7Data + i) ^= 0x8000;
-        *(ADC8Data + i) ^= 0x8000;
-        *(ADC9Data + i) ^= 0x8000;
-    }
+    for(i = start_f; i < end_f; i ++) 
+        *(ADCData + i) ^= 0x8000;
+}
+
+/**
+ * Set up the ADC sampling and re-arm it for the next trigger, should be done after the ADC data of the last pulse is read
+ */
+void  FWC_sis8300_struck_iqfb_func_armADC(void *boardHandle, unsigned int pno)
+{
+    unsigned int pno_f;
+
+    /* check the input */
+    pno_f = (unsigned int)(pno / 16) * 16;
+    if(pno_f < 16) pno_f = 16;                      /* minimum point number is 16 and the number must be a integer time of 16 (limited by the firmware) */
+
+    if(!boardHandle) return;
 
     /* set up the ADC sampling (later put to a commmon function) */    
     RFCB_API_writeRegister((RFCB_struc_moduleData *)boardHandle, DDR2_ACCESS_CONTROL, 0);                   /* disable ddr2 test write interface */
@@ -1098,6 +1101,43 @@ void  FWC_sis8300_struck_iqfb_func_getAllADCData(void *boardHandle, unsigned int
     RFCB_API_writeRegister((RFCB_struc_moduleData *)boardHandle, SIS8300_ACQUISITION_CONTROL_STATUS_REG, 0x00002);  /* armed, wait for trigger */
 }
 
+/**
+ * Get the ADC data from the DRAM, only the channels enabled in chMask (bit n for ADC n) are read, then re-arm the sampling
+ */
+void  FWC_sis8300_struck_iqfb_func_getAllADCData(void *boardHandle, unsigned int pno, unsigned int chMask, unsigned int readStart, unsigned int readPno,
+                                                            short *ADC0Data, short *ADC1Data,            
+                                                            short *ADC2Data, short *ADC3Data,
+                                                            short *ADC4Data, short *ADC5Data,
+                                                            short *ADC6Data, short *ADC7Data,
+                                                            short *ADC8Data, short *ADC9Data)
+{
+    unsigned int ch;
+    short *ADCData[10];
+
+    /* check the input */
+    if(!boardHandle || !ADC0Data || !ADC1Data || !ADC2Data || !ADC3Data || !ADC4Data || !ADC5Data || !ADC6Data || !ADC7Data || !ADC8Data || !ADC9Data) return;
+
+    ADCData[0] = ADC0Data;  ADCData[1] = ADC1Data;
+    ADCData[2] = ADC2Data;  ADCData[3] = ADC3Data;
+    ADCData[4] = ADC4Data;  ADCData[5] = ADC5Data;
+    ADCData[6] = ADC6Data;  ADCData[7] = ADC7Data;
+    ADCData[8] = ADC8Data;  ADCData[9] = ADC9Data;
+
+    /* wait if BUSY or arm (risky) */
+    /*do {
+        RFCB_API_readRegister((RFCB_struc_moduleData *)boardHandle, SIS8300_ACQUISITION_CONTROL_STATUS_REG, &data);       
+    } while((data & 0x3) != 0); */ /* assume time is enough for finishing the sampling */
+
+    /* read the buffers */
+    for(ch = 0; ch < 10; ch ++) {
+        if(chMask & (1U << ch)) 
+            FWC_sis8300_struck_iqfb_func_getADCChannel(boardHandle, pno, ch, readStart, readPno, ADCData[ch]);
+    }
+
+    /* re-arm the sampling */
+    FWC_sis8300_struck_iqfb_func_armADC(boardHandle, pno);
+}
+
 
 
 
@@ -131,7 +131,9 @@ __inline__ void  FWC_sis8300_struck_iqfb_func_getFwStatus(void *boardHandle, uns
 __inline__ void  FWC_sis8300_struck_iqfb_func_getMissingTrigCnt(void *boardHandle, unsigned int *cnt);
 
 __inline__ void  FWC_sis8300_struck_iqfb_func_getAllDAQData(void *boardHandle, unsigned int *buf);                          /* data from BRAM */
-__inline__ void  FWC_sis8300_struck_iqfb_func_getAllADCData(void *boardHandle, unsigned int pno,                            /* data from DRAM */
+__inline__ void  FWC_sis8300_struck_iqfb_func_getADCChannel(void *boardHandle, unsigned int pno, unsigned int ch, unsigned int readStart, unsigned int readPno, short *ADCData);   /* data of a channel from DRAM */
+__inline__ void  FWC_sis8300_struck_iqfb_func_armADC(void *boardHandle, unsigned int pno);                                  /* re-arm the sampling to DRAM */
+__inline__ void  FWC_sis8300_struck_iqfb_func_getAllADCData(void *boardHandle, unsigned int pno, unsigned int chMask, unsigned int readStart, unsigned int readPno,     /* data from DRAM */
                                                             short *ADC0Data, short *ADC1Data,            
                                                             short *ADC2Data, short *ADC3Data,
                                                             short *ADC4Data, short *ADC5Data,
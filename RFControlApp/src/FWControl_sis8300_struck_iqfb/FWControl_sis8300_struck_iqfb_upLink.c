@@ -324,6 +324,38 @@ static void w_setCoefIdOffset(void *ptr)
     }
 }
 
+/* Write callback function, set the channels and the window of the ADC data read from the DRAM */
+static void w_setADCRead(void *ptr)
+{
+    INTD_struc_node                  *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    FWC_sis8300_struck_iqfb_struc_data *arg    = (FWC_sis8300_struck_iqfb_struc_data *)dataNode->privateData;
+
+    if(arg) {
+        arg -> board_ADCReadChMask &= 0x3FF;
+        arg -> board_ADCPrioChMask &= 0x3FF;
+        if(arg -> board_ADCReadStart < 0) arg -> board_ADCReadStart = 0;
+        if(arg -> board_ADCReadPno   < 0) arg -> board_ADCReadPno   = 0;
+    }
+}
+
+/* Write callback function, create the helper thread when the asynchronous reading of the ADC data is enabled */
+static void w_setADCAsync(void *ptr)
+{
+    INTD_struc_node                  *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    FWC_sis8300_struck_iqfb_struc_data *arg    = (FWC_sis8300_struck_iqfb_struc_data *)dataNode->privateData;
+
+    if(arg && arg -> board_ADCAsync) {
+        if(FWC_sis8300_struck_iqfb_func_initADCThread((void *)arg) != 0) {
+            EPICSLIB_func_errlogPrintf("w_setADCAsync: Failed to create the ADC thread, read the ADC data synchronously\n");
+            arg -> board_ADCAsync = 0;
+        }
+    }
+}
+
 /* Write callback function, set the error limits */
 static void w_setErrLimit(void *ptr)
 {
@@ -509,6 +541,11 @@ int FWC_sis8300_struck_iqfb_func_createEpicsData(void *module, const char *modul
     status += INTD_API_createDataNode(moduleName, "B_LIMIT_LO",    (void *)(&arg -> board_ampLimitLo),          (void *)arg, 1, NULL, INTD_LONG, NULL, w_setOLimit, NULL, NULL, INTD_LO, INTD_PASSIVE);
        
     status += INTD_API_createDataNode(moduleName, "B_ADCS_PNO",    (void *)(&arg -> board_ADCSamplePno),        (void *)arg, 1, NULL, INTD_LONG, NULL, NULL,        NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(moduleName, "B_ADCR_CH_MASK",(void *)(&arg -> board_ADCReadChMask),       (void *)arg, 1, NULL, INTD_LONG, NULL, w_setADCRead, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(moduleName, "B_ADCR_START",  (void *)(&arg -> board_ADCReadStart),        (void *)arg, 1, NULL, INTD_LONG, NULL, w_setADCRead, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(moduleName, "B_ADCR_PNO",    (void *)(&arg -> board_ADCReadPno),          (void *)arg, 1, NULL, INTD_LONG, NULL, w_setADCRead, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(moduleName, "B_ADCR_PRIO_MASK",(void *)(&arg -> board_ADCPrioChMask),     (void *)arg, 1, NULL, INTD_LONG, NULL, w_setADCRead, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(moduleName, "B_ADCR_ASYNC",  (void *)(&arg -> board_ADCAsync),            (void *)arg, 1, NULL, INTD_LONG, NULL, w_setADCAsync, NULL, NULL, INTD_LO, INTD_PASSIVE);
 
     status += INTD_API_createDataNode(moduleName, "B_COEF_ID_OFFS",(void *)(&arg -> board_coefIdOffset),        (void *)arg, 1, NULL, INTD_LONG, NULL, w_setCoefIdOffset,  NULL, NULL, INTD_LO, INTD_PASSIVE);
 
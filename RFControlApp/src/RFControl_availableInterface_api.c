@@ -146,7 +146,13 @@ int RFC_API_deleteModule(const char *moduleName)
  * Set up the parameters of the module instance, the command will include:
  *   - RFCFW_NAME  : Set the RFControlFirmware module name that this module instance will be connected to
  *   - THRD_PRIO   : Set the thread priority
- *   - THRD_CRAT   : Create and start the thread
+ *   - DTHRD_PRIO  : Set the priority of the worker thread for diagnostics (default is THRD_PRIO - 10)
+ *   - THRD_CPUS   : Set the CPU list the thread is pinned to, like "2" or "2-3,6" (before THRD_CRAT)
+ *   - DTHRD_CPUS  : Set the CPU list the worker thread for diagnostics is pinned to (before THRD_CRAT)
+ *   - MEM_LOCK    : Lock all current and future memory of the IOC into the RAM (mlockall), dataStr not used
+ *   - BSA_HUGEPAGE: 1 to use huge pages for the BSA capture buffers (shared by all modules), 0 to use normal pages
+ *   - BSA_LAYOUT  : Layout of the BSA capture and post-mortem files, "CHANNEL" (default) or "PULSE" major
+ *   - THRD_CRAT   : Create and start the thread. The threads fault in the module data and BSA buffers before the first pulse
  * Input: 
  *     moduleName : Name of the module instance
  *     cmd        : Command listed above
@@ -198,6 +204,70 @@ int RFC_API_setupModule(const char *moduleName, const char *cmd, const char *dat
             return -1;
         }
 
+    } else if(strcmp("DTHRD_PRIO", cmd) == 0) {
+
+        /* --- set thread priority of the worker thread --- */
+        if(!dataStr || !dataStr[0]){
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set diagnostics thread priority\n");
+            return -1;
+        }
+        
+        sscanf(dataStr, "%d", &var_priority);
+        
+        if(RFC_func_setDiagThreadPriority(ptr_dataInstance, (unsigned int)var_priority) != 0) {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set diagnostics thread priority\n");
+            return -1;
+        }
+
+    } else if(strcmp("THRD_CPUS", cmd) == 0) {
+
+        /* --- set CPU affinity of the thread --- */
+        if(RFC_func_setThreadCpus(ptr_dataInstance, dataStr) != 0) {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set thread CPUs\n");
+            return -1;
+        }
+
+    } else if(strcmp("DTHRD_CPUS", cmd) == 0) {
+
+        /* --- set CPU affinity of the worker thread --- */
+        if(RFC_func_setDiagThreadCpus(ptr_dataInstance, dataStr) != 0) {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set diagnostics thread CPUs\n");
+            return -1;
+        }
+
+    } else if(strcmp("MEM_LOCK", cmd) == 0) {
+
+        /* --- lock the memory --- */
+        if(RFC_func_rtLockMemory() != 0) {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to lock the memory\n");
+            return -1;
+        }
+
+    } else if(strcmp("BSA_HUGEPAGE", cmd) == 0) {
+
+        /* --- huge pages for the BSA buffers --- */
+        if(!dataStr || !dataStr[0]){
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set BSA huge page\n");
+            return -1;
+        }
+
+        SDAQ_func_poolSetHugePage(atoi(dataStr));
+
+    } else if(strcmp("BSA_LAYOUT", cmd) == 0) {
+
+        /* --- layout of the BSA files --- */
+        if(!dataStr) {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Failed to set BSA file layout\n");
+            return -1;
+        } else if(strcmp("CHANNEL", dataStr) == 0) {
+            SDAQ_func_setFileLayout(&ptr_dataInstance -> bsa_session, SDAQ_CONST_LAYOUT_CHANNEL_MAJOR);
+        } else if(strcmp("PULSE", dataStr) == 0) {
+            SDAQ_func_setFileLayout(&ptr_dataInstance -> bsa_session, SDAQ_CONST_LAYOUT_PULSE_MAJOR);
+        } else {
+            EPICSLIB_func_errlogPrintf("RFC_API_setupModule: Unknown BSA file layout %s\n", dataStr);
+            return -1;
+        }
+
     } else if(strcmp("THRD_CRAT", cmd) == 0) {
         
         /* --- create thread --- */
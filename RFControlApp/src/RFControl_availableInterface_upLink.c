@@ -13,6 +13,7 @@
  * Description: Remove the part for firmware data creation
  ****************************************************/
 #include <stdlib.h>             
+#include <stdio.h>
 #include <string.h>
 #include <errlog.h>
 
@@ -39,9 +40,218 @@ static void w_setFileName(void *ptr)
 
         strcat(arg -> bsa_dataFileName_full, arg -> bsa_dataFileName);
         strcat(arg -> bsa_wfFileName_full,   arg -> bsa_wfFileName);
+
+        strcpy(arg -> bsa_streamFileName_full, arg -> bsa_sr_folder);
+        strcat(arg -> bsa_streamFileName_full, "/");
+        strcat(arg -> bsa_streamFileName_full, arg -> bsa_streamFileName);
+
+        strcpy(arg -> bsa_pmFileName_full, arg -> bsa_sr_folder);
+        strcat(arg -> bsa_pmFileName_full, "/");
+        strcat(arg -> bsa_pmFileName_full, arg -> bsa_pmFileName);
+    }
+}
+
+/* Write callback function, start or stop the streaming of the data */
+static void w_setStream(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(!arg) return;
+
+    if(arg -> bsa_stream) {
+        if(SDAQ_func_streamStart(&arg -> bsa_session, arg -> bsa_streamFileName_full, arg -> bsa_streamRotate_MB, arg -> bsa_streamRotate_s) == 0) {
+            sprintf(arg -> bsa_sr_statusStr, "streaming to %.200s", arg -> bsa_streamFileName_full);
+        } else {
+            arg -> bsa_stream = 0;
+            sprintf(arg -> bsa_sr_statusStr, "failed to start streaming %.200s", arg -> bsa_streamFileName_full);
+        }
+    } else {
+        if(SDAQ_func_streamStop(&arg -> bsa_session) == 0)
+            sprintf(arg -> bsa_sr_statusStr, "streaming %.200s stopped", arg -> bsa_streamFileName_full);
+    }
+}
+
+/* Read callback function, get the status of the streaming */
+static void r_getStreamStatus(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    long var_fillPercent, var_dropCnt, var_fileCnt;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) {
+        if(SDAQ_func_getStreamStatus(&arg -> bsa_session, &var_fillPercent, &var_dropCnt, &var_fileCnt) == SDAQ_CONST_STREAM_FAILED && arg -> bsa_stream) {
+            arg -> bsa_stream = 0;
+            sprintf(arg -> bsa_sr_statusStr, "streaming %.200s failed", arg -> bsa_streamFileName_full);
+        }
+
+        arg -> bsa_streamFillPercent = var_fillPercent;
+        arg -> bsa_streamDropCnt     = var_dropCnt;
+        arg -> bsa_streamFileCnt     = var_fileCnt;
+    }
+}
+
+/* Read callback function, calculate the latency percentiles */
+static void r_calcLatPercentiles(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) RFC_func_latCalcPercentiles(&arg -> latHist);
+}
+
+/* Write callback function, request to reset the latency histogram (executed by the main thread) */
+static void w_resetLatHist(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) arg -> latHist.resetRequest = 1;
+}
+
+/* Read callback function, produce the time-ordered view of a recent history buffer */
+static void r_linearizeHist(void *ptr)
+{
+    INTD_struc_node   *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_history *hist     = (RFC_struc_history *)dataNode->privateData;
+
+    RFC_func_histLinearize(hist);
+}
+
+/* Write callback function, resolve the probe selection */
+static void w_selectProbe(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_probe      *probe    = (RFC_struc_probe *)dataNode->privateData;
+    RFC_struc_moduleData *arg      = probe ? (RFC_struc_moduleData *)probe -> module : NULL;
+
+    if(arg) RFC_func_selectProbe(arg, (int)(probe - arg -> diag_probe));
+}
+
+/* Write callback function, enable or disable the post-mortem buffer */
+static void w_setPm(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(!arg) return;
+
+    if(arg -> bsa_pmEnable) {
+        if(SDAQ_func_pmEnable(&arg -> bsa_session, arg -> bsa_pmFileName_full, (int)arg -> bsa_pmPulseNum, (int)arg -> bsa_pmPostNum) == 0) {
+            sprintf(arg -> bsa_sr_statusStr, "post-mortem armed to %.200s", arg -> bsa_pmFileName_full);
+        } else {
+            arg -> bsa_pmEnable = 0;
+            sprintf(arg -> bsa_sr_statusStr, "failed to enable post-mortem %.200s", arg -> bsa_pmFileName_full);
+        }
+    } else {
+        SDAQ_func_pmDisable(&arg -> bsa_session);
     }
 }
 
+/* Read callback function, get the status of the post-mortem buffer */
+static void r_getPmStatus(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    long var_dumpCnt;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) {
+        SDAQ_func_getPmStatus(&arg -> bsa_session, &var_dumpCnt);
+        arg -> bsa_pmDumpCnt = var_dumpCnt;
+    }
+}
+
+/* Read callback function, get the memory of the capture buffer pool */
+static void r_getPoolStat(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    double var_used_MB, var_free_MB;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) {
+        SDAQ_func_poolGetStat(&var_used_MB, &var_free_MB);
+        arg -> bsa_poolUsed_MB = var_used_MB;
+        arg -> bsa_poolFree_MB = var_free_MB;
+    }
+}
+
+/* Write callback function, enable or disable the compression of the BSA files of this module */
+static void w_setCompress(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg && SDAQ_func_setCodec(&arg -> bsa_session, arg -> bsa_compress ? SDAQ_CONST_CODEC_SHUFFLE_LZ : SDAQ_CONST_CODEC_NONE) != 0)
+        arg -> bsa_compress = 0;                                /* the codec failed its self test, the files stay uncompressed */
+}
+
+/* Read callback function, get the compression ratio and speed of the last compressed BSA file */
+static void r_getCompressStat(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    double var_ratio, var_speed_MBps;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) {
+        SDAQ_func_getCodecStat(&arg -> bsa_session, &var_ratio, &var_speed_MBps);
+        arg -> bsa_compressRatio      = var_ratio;
+        arg -> bsa_compressSpeed_MBps = var_speed_MBps;
+    }
+}
+
+/* Write callback function, set the channels and length of the BSA captures, applied from the next capture */
+static void w_setCapture(void *ptr)
+{
+    INTD_struc_node      *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_moduleData *arg      = (RFC_struc_moduleData *)dataNode->privateData;
+
+    if(arg) {
+        if(arg -> bsa_dataPulseNum < 1)                             arg -> bsa_dataPulseNum = 1;
+        if(arg -> bsa_dataPulseNum > SDAQ_CONST_BUF_SIZE)           arg -> bsa_dataPulseNum = SDAQ_CONST_BUF_SIZE;
+        if(arg -> bsa_wfPulseNum   < 1)                             arg -> bsa_wfPulseNum   = 1;
+        if(arg -> bsa_wfPulseNum   > SDAQ_CONST_WF_NUM_SUPPORTED)   arg -> bsa_wfPulseNum   = SDAQ_CONST_WF_NUM_SUPPORTED;
+
+        /* the mask is sign extended so that -1 selects all nodes */
+        SDAQ_func_setDataCapture(&arg -> bsa_session, (uint64_t)(int64_t)arg -> bsa_dataChMask, (int)arg -> bsa_dataPulseNum);
+        SDAQ_func_setWfCapture(&arg -> bsa_session,   (uint64_t)(int64_t)arg -> bsa_wfChMask,   (int)arg -> bsa_wfPulseNum);
+    }
+}
+
+/* Read callback function, calculate the run rate of a diagnostics task */
+static void r_calcTaskRate(void *ptr)
+{
+    INTD_struc_node *dataNode = (INTD_struc_node *)ptr;
+    
+    if(!dataNode) return; 
+    RFC_struc_task  *task     = (RFC_struc_task *)dataNode->privateData;
+
+    RFC_func_schedCalcRate(task);
+}
+
 /* Write callback function, set the maximum energy gain */
 /*static void w_setMaxEGain(void *ptr)
 {
@@ -171,7 +381,15 @@ static int RFC_func_analogWfCreateData(const char *moduleName, const char *wfNam
  */
 int RFC_func_createEpicsData(RFC_struc_moduleData *arg)
 {
-    int status = 0;
+    int  status = 0;
+    int  i;
+    char var_dataName[64];
+    char var_suffix[8];
+    RFC_struc_task *task;
+    RFC_struc_statQty *qty;
+    int  w;
+
+    static const char *var_winName[RFC_CONST_STAT_WIN_NUM] = {"1S", "10S", "60S"};
 
     if(!arg) return -1;
 
@@ -202,6 +420,7 @@ int RFC_func_createEpicsData(RFC_struc_moduleData *arg)
     status += INTD_API_createDataNode(arg->moduleName, "APP_FF_ENA",        (void *)(&arg->fbData.fb_feedForwardEnabled),   (void *)arg, 1, NULL, INTD_USHORT, NULL, NULL, NULL, NULL, INTD_BO, INTD_PASSIVE);        
     
     status += INTD_API_createDataNode(arg->moduleName, "APP_REFT_ENA",      (void *)(&arg->fbData.fb_refTrackEnabled),      (void *)arg, 1, NULL, INTD_USHORT, NULL, NULL, NULL, NULL, INTD_BO, INTD_PASSIVE);        
+    status += INTD_API_createDataNode(arg->moduleName, "APP_DEMOD_MODE",    (void *)(&arg->fbData.fb_demodMode),            (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);        
 
     /*-----------------------------------
      * Read only data - 120 Hz (for variables might need BSA)
@@ -245,25 +464,98 @@ int RFC_func_createEpicsData(RFC_struc_moduleData *arg)
 
     status += INTD_API_createDataNode(arg->moduleName, "BSA_DATA_PERCENT",  (void *)(&arg -> bsa_dataBSAPercent),(void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
     status += INTD_API_createDataNode(arg->moduleName, "BSA_WF_PERCENT",    (void *)(&arg -> bsa_wfBSAPercent),  (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S); 
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_FILENAME",(void *)(arg -> bsa_streamFileName),(void *)arg, EPICSLIB_CONST_NAME_LEN, NULL, INTD_CHAR, NULL, w_setFileName, NULL, NULL, INTD_WFO, INTD_PASSIVE);  /* w */
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM",        (void *)(&arg -> bsa_stream),       (void *)arg, 1, NULL, INTD_USHORT, NULL, w_setStream, NULL, NULL, INTD_BO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_ROT_MB", (void *)(&arg -> bsa_streamRotate_MB),(void *)arg, 1, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_ROT_S",  (void *)(&arg -> bsa_streamRotate_s), (void *)arg, 1, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_FILL",   (void *)(&arg -> bsa_streamFillPercent),(void *)arg, 1, NULL, INTD_LONG, r_getStreamStatus, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_DROP",   (void *)(&arg -> bsa_streamDropCnt),  (void *)arg, 1, NULL, INTD_LONG, r_getStreamStatus, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_STREAM_FILES",  (void *)(&arg -> bsa_streamFileCnt),  (void *)arg, 1, NULL, INTD_LONG, r_getStreamStatus, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_FILENAME",   (void *)(arg -> bsa_pmFileName),    (void *)arg, EPICSLIB_CONST_NAME_LEN, NULL, INTD_CHAR, NULL, w_setFileName, NULL, NULL, INTD_WFO, INTD_PASSIVE);  /* w */
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_ENABLE",     (void *)(&arg -> bsa_pmEnable),     (void *)arg, 1, NULL, INTD_USHORT, NULL, w_setPm, NULL, NULL, INTD_BO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_PULSES",     (void *)(&arg -> bsa_pmPulseNum),   (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_POST",       (void *)(&arg -> bsa_pmPostNum),    (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_TRIG_MASK",  (void *)(&arg -> bsa_pmTrigMask),   (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_TRIGGER",    (void *)(&arg -> bsa_pmTrigger),    (void *)arg, 1, NULL, INTD_USHORT, NULL, NULL, NULL, NULL, INTD_BO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_DUMPS",      (void *)(&arg -> bsa_pmDumpCnt),    (void *)arg, 1, NULL, INTD_LONG,   r_getPmStatus, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_PM_LAST_TRIG",  (void *)(arg -> bsa_pmLastTrig),    (void *)arg, EPICSLIB_CONST_NAME_LEN, NULL, INTD_CHAR, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_DATA_DROP",     (void *)(&arg -> bsa_session.dataJob.dropCnt), (void *)arg, 1, NULL, INTD_LONG, NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);   /* captures dropped, the writer was busy */
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_WF_DROP",       (void *)(&arg -> bsa_session.wfJob.dropCnt),   (void *)arg, 1, NULL, INTD_LONG, NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_POOL_USED_MB",  (void *)(&arg -> bsa_poolUsed_MB),   (void *)arg, 1, NULL, INTD_DOUBLE, r_getPoolStat, NULL, NULL, NULL, INTD_AI, INTD_10S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_POOL_FREE_MB",  (void *)(&arg -> bsa_poolFree_MB),   (void *)arg, 1, NULL, INTD_DOUBLE, r_getPoolStat, NULL, NULL, NULL, INTD_AI, INTD_10S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_COMPRESS",      (void *)(&arg -> bsa_compress),     (void *)arg, 1, NULL, INTD_USHORT, NULL, w_setCompress, NULL, NULL, INTD_BO, INTD_PASSIVE);  /* w */
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_COMPRESS_RATIO",(void *)(&arg -> bsa_compressRatio),(void *)arg, 1, NULL, INTD_DOUBLE, r_getCompressStat, NULL, NULL, NULL, INTD_AI, INTD_10S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_COMPRESS_MBPS", (void *)(&arg -> bsa_compressSpeed_MBps), (void *)arg, 1, NULL, INTD_DOUBLE, r_getCompressStat, NULL, NULL, NULL, INTD_AI, INTD_10S);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_DATA_CH_MASK",  (void *)(&arg -> bsa_dataChMask),   (void *)arg, 1, NULL, INTD_LONG,   NULL, w_setCapture, NULL, NULL, INTD_LO, INTD_PASSIVE);  /* bit i for the i-th node created */
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_DATA_PULSES",   (void *)(&arg -> bsa_dataPulseNum), (void *)arg, 1, NULL, INTD_LONG,   NULL, w_setCapture, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_WF_CH_MASK",    (void *)(&arg -> bsa_wfChMask),     (void *)arg, 1, NULL, INTD_LONG,   NULL, w_setCapture, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "BSA_WF_PULSES",     (void *)(&arg -> bsa_wfPulseNum),   (void *)arg, 1, NULL, INTD_LONG,   NULL, w_setCapture, NULL, NULL, INTD_LO, INTD_PASSIVE);
     
     /*-----------------------------------
      * Diagnostics 
      *-----------------------------------*/  
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PHA_ERR_DEG",  (void *)(arg -> fbData.fb_phaErrArray_deg), NULL, RFC_CONST_RECENT_HISTORY_BUF_DEPTH, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);  /* r */
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PHA_ERR_DEG",  (void *)(arg -> fbData.fb_phaErrHist_deg.pub), (void *)(&arg -> fbData.fb_phaErrHist_deg), RFC_CONST_RECENT_HISTORY_BUF_DEPTH, NULL, INTD_DOUBLE, r_linearizeHist, NULL, NULL, NULL, INTD_WFI, INTD_1S);  /* r */
 
     status += INTD_API_createDataNode(arg->moduleName, "DIAG_IRQ_LATENCY",  (void *)(&arg -> IRQDelayCnt),  (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
     status += INTD_API_createDataNode(arg->moduleName, "DIAG_IRQ_CNT",      (void *)(&arg -> IRQCnt),       (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
     status += INTD_API_createDataNode(arg->moduleName, "DIAG_IRQ_MISSING",  (void *)(&arg -> IRQMissingCnt),(void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PIPE_DROP",    (void *)(&arg -> pipe.dropCnt), (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_DEMOD_MODE",   (void *)(&arg -> diag_demodMode),(void *)arg, 1, NULL, INTD_LONG, NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_DEMOD_IMPL",   (void *)(arg -> fb_demodImpl),  (void *)arg, 32, NULL, INTD_CHAR, NULL, NULL, NULL, NULL, INTD_WFI, INTD_10S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_IQ2AP_MODE",   (void *)(&arg -> diag_iq2apMode),    (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_IQ2AP_ERR_DEG",(void *)(&arg -> diag_iq2apErr_deg), (void *)arg, 1, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_10S);
+
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_P50_US",   (void *)(&arg -> latHist.p50_us),   (void *)arg, 1, NULL, INTD_DOUBLE, r_calcLatPercentiles, NULL, NULL, NULL, INTD_AI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_P99_US",   (void *)(&arg -> latHist.p99_us),   (void *)arg, 1, NULL, INTD_DOUBLE, r_calcLatPercentiles, NULL, NULL, NULL, INTD_AI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_P999_US",  (void *)(&arg -> latHist.p999_us),  (void *)arg, 1, NULL, INTD_DOUBLE, r_calcLatPercentiles, NULL, NULL, NULL, INTD_AI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_MAX_US",   (void *)(&arg -> latHist.max_us),   (void *)arg, 1, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_CNT",      (void *)(&arg -> latHist.totalCnt), (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_HIST",     (void *)(arg -> latHist.bin),       NULL, RFC_CONST_LAT_BIN_NUM, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);    /* r */
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_HIST_EDGE_US", (void *)(arg -> latHist.binEdge_us), NULL, RFC_CONST_LAT_BIN_NUM, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_WFI, INTD_10S);  /* r, lower edge of the bins */
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_LAT_RESET",    (void *)(&arg -> latHist.resetRequest), (void *)arg, 1, NULL, INTD_USHORT, NULL, w_resetLatHist, NULL, NULL, INTD_BO, INTD_PASSIVE);
+
+    for(i = 0; i < RFC_CONST_PROBE_NUM; i ++) {                                                 /* the first probe has no suffix in the names, others are 2, 3 ... */
+        if(i == 0) var_suffix[0] = '\0';
+        else       sprintf(var_suffix, "%d", i + 1);
+
+        sprintf(var_dataName, "DIAG_PROBE_SEL%s",    var_suffix);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&arg -> diag_probe[i].probeDataSel),   (void *)(&arg -> diag_probe[i]),           1, NULL, INTD_LONG,   NULL,            w_selectProbe, NULL, NULL, INTD_LO,  INTD_PASSIVE);
+        sprintf(var_dataName, "DIAG_PROBE_DATA%s",   var_suffix);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(arg -> diag_probe[i].probeHist.pub),   (void *)(&arg -> diag_probe[i].probeHist), RFC_CONST_RECENT_HISTORY_BUF_DEPTH, NULL, INTD_DOUBLE, r_linearizeHist, NULL, NULL, NULL, INTD_WFI, INTD_1S);   /* r */
+        sprintf(var_dataName, "DIAG_PROBE_STATUS%s", var_suffix);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(arg -> diag_probe[i].probeStatus),     (void *)arg,                               128, NULL, INTD_CHAR,   NULL,            NULL, NULL, NULL, INTD_WFI, INTD_1S);
+    }
+
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_STATUS_VECT",  (void *)(&arg -> statusVector), (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
 
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_SEL",    (void *)(&arg -> diag_probeDataSel), (void *)arg, 1,   NULL, INTD_LONG, NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_DATA",   (void *)(arg -> diag_probeData),     NULL, RFC_CONST_RECENT_HISTORY_BUF_DEPTH, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);         /* r */
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_STATUS", (void *)(arg -> diag_probeStatus),   (void *)arg, 128, NULL, INTD_CHAR, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_SCHED_DEADLINE_US", (void *)(&arg -> diag_sched.deadline_us), (void *)arg, 1, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AO, INTD_PASSIVE);
+    status += INTD_API_createDataNode(arg->moduleName, "DIAG_SCHED_LATE",        (void *)(&arg -> diag_sched.lateCnt),     (void *)arg, 1, NULL, INTD_LONG,   NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
 
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_SEL2",    (void *)(&arg -> diag_probeDataSel2), (void *)arg, 1,   NULL, INTD_LONG, NULL, NULL, NULL, NULL, INTD_LO, INTD_PASSIVE);
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_DATA2",   (void *)(arg -> diag_probeData2),     NULL, RFC_CONST_RECENT_HISTORY_BUF_DEPTH, NULL, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);         /* r */
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_PROBE_STATUS2", (void *)(arg -> diag_probeStatus2),   (void *)arg, 128, NULL, INTD_CHAR, NULL, NULL, NULL, NULL, INTD_WFI, INTD_1S);
+    for(i = 0; i < arg -> diag_sched.taskNum; i ++) {                                           /* statistics of the diagnostics tasks */
+        task = &arg -> diag_sched.task[i];
 
-    status += INTD_API_createDataNode(arg->moduleName, "DIAG_STATUS_VECT",  (void *)(&arg -> statusVector), (void *)arg, 1, NULL, INTD_LONG,  NULL, NULL, NULL, NULL, INTD_LI, INTD_1S);
+        sprintf(var_dataName, "DIAG_TASK_%s_RATE",    task -> name);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&task -> runRate_Hz), (void *)task, 1, NULL, INTD_DOUBLE, r_calcTaskRate, NULL, NULL, NULL, INTD_AI, INTD_1S);
+        sprintf(var_dataName, "DIAG_TASK_%s_SKIP",    task -> name);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&task -> skipCnt),    (void *)task, 1, NULL, INTD_LONG,   NULL,           NULL, NULL, NULL, INTD_LI, INTD_1S);
+        sprintf(var_dataName, "DIAG_TASK_%s_COST_US", task -> name);
+        status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&task -> cost_us),    (void *)task, 1, NULL, INTD_DOUBLE, NULL,           NULL, NULL, NULL, INTD_AI, INTD_1S);
+    }
+
+    for(i = 0; i < arg -> diag_stats.qtyNum; i ++) {                                            /* running statistics, scanned when the windows are refreshed (1 Hz) */
+        qty = &arg -> diag_stats.qty[i];
+
+        for(w = 0; w < RFC_CONST_STAT_WIN_NUM; w ++) {
+            sprintf(var_dataName, "STAT_%s_MEAN_%s", qty -> name, var_winName[w]);
+            status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&qty -> win[w].mean), (void *)arg, 1, &arg -> ioscanpvt_stats, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_IOINT);
+            sprintf(var_dataName, "STAT_%s_RMS_%s",  qty -> name, var_winName[w]);
+            status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&qty -> win[w].rms),  (void *)arg, 1, &arg -> ioscanpvt_stats, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_IOINT);
+            sprintf(var_dataName, "STAT_%s_MIN_%s",  qty -> name, var_winName[w]);
+            status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&qty -> win[w].min),  (void *)arg, 1, &arg -> ioscanpvt_stats, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_IOINT);
+            sprintf(var_dataName, "STAT_%s_MAX_%s",  qty -> name, var_winName[w]);
+            status += INTD_API_createDataNode(arg->moduleName, var_dataName, (void *)(&qty -> win[w].max),  (void *)arg, 1, &arg -> ioscanpvt_stats, INTD_DOUBLE, NULL, NULL, NULL, NULL, INTD_AI, INTD_IOINT);
+        }
+    }
 
     return status;
 }
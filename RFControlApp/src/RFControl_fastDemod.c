@@ -0,0 +1,314 @@
+/****************************************************
+ * RFControl_fastDemod.c
+ *
+ * Source file for the fast demodulation of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RFC_FAST_DEMOD_X86
+#endif
+
+#include "RFControl_fastDemod.h"
+
+/*======================================
+ * Private Data and Routines
+ *======================================*/
+/**
+ * Inner loop: dot products of the raw data with the weighted coefficients in the window
+ */
+typedef void (*RFC_type_demodDot)(const short *x, const double *c, const double *s, long len, double *I, double *Q);
+
+static RFC_type_demodDot RFC_demodDot     = NULL;
+static const char       *RFC_demodDotName = "none";
+
+/* Scalar version, also handles the tails of the SIMD versions */
+static void RFC_func_demodDotScalar(const short *x, const double *c, const double *s, long len, double *I, double *Q)
+{
+    long i;
+    double var_I = 0;
+    double var_Q = 0;
+
+    for(i = 0; i < len; i ++) {
+        var_I += x[i] * c[i];
+        var_Q += x[i] * s[i];
+    }
+
+    *I = var_I;
+    *Q = var_Q;
+}
+
+#ifdef RFC_FAST_DEMOD_X86
+/* SSE4.1 version, 4 points per step (the shorts are widened with pmovsxwd) */
+__attribute__((target("sse4.1")))
+static void RFC_func_demodDotSSE41(const short *x, const double *c, const double *s, long len, double *I, double *Q)
+{
+    long    i;
+    long    var_len4 = len & ~3L;
+    __m128i var_x32;
+    __m128d var_xLo, var_xHi;
+    __m128d var_I = _mm_setzero_pd();
+    __m128d var_Q = _mm_setzero_pd();
+    double  var_tI, var_tQ;
+    double  var_buf[2];
+
+    for(i = 0; i < var_len4; i += 4) {
+        var_x32 = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(x + i)));
+        var_xLo = _mm_cvtepi32_pd(var_x32);
+        var_xHi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(var_x32, var_x32));
+
+        var_I = _mm_add_pd(var_I, _mm_add_pd(_mm_mul_pd(var_xLo, _mm_loadu_pd(c + i)), _mm_mul_pd(var_xHi, _mm_loadu_pd(c + i + 2))));
+        var_Q = _mm_add_pd(var_Q, _mm_add_pd(_mm_mul_pd(var_xLo, _mm_loadu_pd(s + i)), _mm_mul_pd(var_xHi, _mm_loadu_pd(s + i + 2))));
+    }
+
+    /* the tail */
+    RFC_func_demodDotScalar(x + var_len4, c + var_len4, s + var_len4, len - var_len4, &var_tI, &var_tQ);
+
+    _mm_storeu_pd(var_buf, var_I); *I = var_buf[0] + var_buf[1] + var_tI;
+    _mm_storeu_pd(var_buf, var_Q); *Q = var_buf[0] + var_buf[1] + var_tQ;
+}
+
+/* AVX2 version, 4 points per step in one 256 bits register */
+__attribute__((target("avx2")))
+static void RFC_func_demodDotAVX2(const short *x, const double *c, const double *s, long len, double *I, double *Q)
+{
+    long    i;
+    long    var_len4 = len & ~3L;
+    __m256d var_x;
+    __m256d var_I = _mm256_setzero_pd();
+    __m256d var_Q = _mm256_setzero_pd();
+    double  var_tI, var_tQ;
+    double  var_buf[4];
+
+    for(i = 0; i < var_len4; i += 4) {
+        var_x = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(x + i))));
+        var_I = _mm256_add_pd(var_I, _mm256_mul_pd(var_x, _mm256_loadu_pd(c + i)));
+        var_Q = _mm256_add_pd(var_Q, _mm256_mul_pd(var_x, _mm256_loadu_pd(s + i)));
+    }
+
+    /* the tail */
+    RFC_func_demodDotScalar(x + var_len4, c + var_len4, s + var_len4, len - var_len4, &var_tI, &var_tQ);
+
+    _mm256_storeu_pd(var_buf, var_I); *I = var_buf[0] + var_buf[1] + var_buf[2] + var_buf[3] + var_tI;
+    _mm256_storeu_pd(var_buf, var_Q); *Q = var_buf[0] + var_buf[1] + var_buf[2] + var_buf[3] + var_tQ;
+}
+#endif
+
+/**
+ * Select the inner loop by the CPU features
+ */
+static void RFC_func_demodDotSelect(void)
+{
+    RFC_demodDot     = RFC_func_demodDotScalar;
+    RFC_demodDotName = "scalar";
+
+#ifdef RFC_FAST_DEMOD_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        RFC_demodDot     = RFC_func_demodDotAVX2;
+        RFC_demodDotName = "avx2";
+    } else if(__builtin_cpu_supports("sse4.1")) {
+        RFC_demodDot     = RFC_func_demodDotSSE41;
+        RFC_demodDotName = "sse4.1";
+    }
+#endif
+}
+
+/**
+ * Get the coefficient offset of a channel for the current pulse
+ */
+static long RFC_func_fastDemodGetOffset(RFC_struc_demodKernel *kernel, long coefId)
+{
+    long var_offset = (coefId + kernel -> startId) % RFC_CONST_DEMOD_N;
+
+    if(var_offset < 0) var_offset += RFC_CONST_DEMOD_N;
+
+    return var_offset;
+}
+
+/**
+ * Put the averaged I/Q into the RF waveform, and calculate the amplitude and phase
+ */
+static void RFC_func_fastDemodPutAvg(RFLIB_struc_RFWaveform *data, double I, double Q)
+{
+    double var_pha_deg = atan2(Q, I) * 180.0 / M_PI + data -> phaOffset_deg;
+
+    if(var_pha_deg >  180) var_pha_deg -= 360;
+    if(var_pha_deg < -180) var_pha_deg += 360;
+
+    data -> avgDataI       = I;
+    data -> avgDataQ       = Q;
+    data -> avgDataAmp     = sqrt(I * I + Q * Q) * data -> ampScale;
+    data -> avgDataPha_deg = var_pha_deg;
+}
+
+/**
+ * Rebuild the weighted coefficients if the window or the sampling settings changed. The window is calculated
+ *   in the same way as the RFLIB average (not rounded to full demodulation periods), and the rebuilt kernel
+ *   needs to be checked against RFLIB again before use
+ */
+static void RFC_func_fastDemodUpdate(RFC_struc_demodKernel *kernel, RFLIB_struc_RFWaveform *data)
+{
+    long   k;
+    long   var_startId;
+    long   var_len;
+    double var_w;
+
+    /* nothing changed */
+    if(kernel -> avgStartTime_ns == data -> avgStartTime_ns &&
+       kernel -> avgTime_ns      == data -> avgTime_ns      &&
+       kernel -> sampleFreq_MHz  == data -> sampleFreq_MHz  &&
+       kernel -> sampleDelay_ns  == data -> sampleDelay_ns  &&
+       kernel -> pointNum        == data -> pointNum) return;
+
+    kernel -> avgStartTime_ns = data -> avgStartTime_ns;
+    kernel -> avgTime_ns      = data -> avgTime_ns;
+    kernel -> sampleFreq_MHz  = data -> sampleFreq_MHz;
+    kernel -> sampleDelay_ns  = data -> sampleDelay_ns;
+    kernel -> pointNum        = data -> pointNum;
+    kernel -> valid           = 0;
+    kernel -> checkState      = RFC_CONST_DEMOD_CHECK_PENDING;
+
+    /* get the window */
+    var_startId = (long)((data -> avgStartTime_ns - data -> sampleDelay_ns) * data -> sampleFreq_MHz / 1000.0 + 0.5);
+    var_len     = (long)(data -> avgTime_ns * data -> sampleFreq_MHz / 1000.0 + 0.5);
+
+    if(var_startId < 0) var_startId = 0;
+    if(var_startId + var_len > data -> pointNum) var_len = data -> pointNum - var_startId;
+    if(var_startId + var_len > RFC_CONST_WF_PNO) var_len = RFC_CONST_WF_PNO - var_startId;
+    if(var_len <= 0) return;
+
+    /* build the weighted coefficients */
+    var_w = 2.0 / var_len;
+
+    for(k = 0; k < var_len + RFC_CONST_DEMOD_N; k ++) {
+        kernel -> wCos[k] =  var_w * cos(2.0 * M_PI * RFC_CONST_DEMOD_M * (k % RFC_CONST_DEMOD_N) / RFC_CONST_DEMOD_N);
+        kernel -> wSin[k] = -var_w * sin(2.0 * M_PI * RFC_CONST_DEMOD_M * (k % RFC_CONST_DEMOD_N) / RFC_CONST_DEMOD_N);
+    }
+
+    kernel -> startId = var_startId;
+    kernel -> len     = var_len;
+    kernel -> valid   = 1;
+}
+
+/**
+ * Dot product of the raw data in the window with the weighted coefficients
+ */
+static void RFC_func_fastDemodDot(RFC_struc_demodKernel *kernel, const short *wfRaw, long coefId, double *I, double *Q)
+{
+    long var_offset = RFC_func_fastDemodGetOffset(kernel, coefId);
+
+    RFC_demodDot(wfRaw + kernel -> startId, kernel -> wCos + var_offset, kernel -> wSin + var_offset, kernel -> len, I, Q);
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the kernel of a channel, the vectors will be built at the first call of RFC_func_fastDemodAvg
+ */
+void RFC_func_fastDemodInit(RFC_struc_demodKernel *kernel)
+{
+    if(!RFC_demodDot) RFC_func_demodDotSelect();
+
+    if(!kernel) return;
+
+    memset((void *)kernel, 0, sizeof(RFC_struc_demodKernel));
+    kernel -> pointNum = -1;                                                /* force the first build */
+}
+
+/**
+ * Demodulate and average the samples in the window only, as a dot product of the raw data with the weighted
+ *   coefficients. The results are put into avgDataI/Q/Amp/Pha_deg of the RF waveform, the waveforms (wfI, wfQ ...) 
+ *   are not touched. Fails without touching the averages if the kernel has not passed RFC_func_fastDemodCheck
+ * Input:
+ *     kernel           : Precomputed coefficients of the channel
+ *     data             : The RF waveform, provides the window, sampling and scaling settings
+ *     wfRaw            : Raw ADC data
+ *     coefId           : Demodulation coefficient id of the first point of the raw data
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_fastDemodAvg(RFC_struc_demodKernel *kernel, RFLIB_struc_RFWaveform *data, const short *wfRaw, long coefId)
+{
+    double var_I, var_Q;
+
+    /* Check the input */
+    if(!kernel || !data || !wfRaw || data -> sampleFreq_MHz <= 0) return -1;
+
+    if(!RFC_demodDot) RFC_func_demodDotSelect();
+
+    /* Update the kernel */
+    RFC_func_fastDemodUpdate(kernel, data);
+
+    if(!kernel -> valid || kernel -> checkState != RFC_CONST_DEMOD_CHECK_PASSED) return -1;
+
+    /* Demodulate the window */
+    RFC_func_fastDemodDot(kernel, wfRaw, coefId, &var_I, &var_Q);
+    RFC_func_fastDemodPutAvg(data, var_I, var_Q);
+
+    return 0;
+}
+
+/**
+ * Check the kernel of a channel against the average calculated by RFLIB for the same raw data. The kernel is
+ *   only used by RFC_func_fastDemodAvg after it passed the check, if it fails it will not be used until the
+ *   window or the sampling settings change. If the signal is too small, no decision is made
+ * Input:
+ *     kernel           : Precomputed coefficients of the channel
+ *     data             : The RF waveform, demodulated and averaged by RFLIB
+ *     wfRaw            : Raw ADC data used by RFLIB
+ *     coefId           : Demodulation coefficient id of the first point of the raw data
+ * Return:
+ *     0                : The kernel passed the check (now or before)
+ *    -1                : Not passed (failed or no decision)
+ */
+int RFC_func_fastDemodCheck(RFC_struc_demodKernel *kernel, const RFLIB_struc_RFWaveform *data, const short *wfRaw, long coefId)
+{
+    double var_I, var_Q;
+    double var_ref;
+    double var_err;
+
+    /* Check the input */
+    if(!kernel || !data || !wfRaw || data -> sampleFreq_MHz <= 0) return -1;
+
+    if(!RFC_demodDot) RFC_func_demodDotSelect();
+
+    RFC_func_fastDemodUpdate(kernel, (RFLIB_struc_RFWaveform *)data);
+
+    if(kernel -> checkState != RFC_CONST_DEMOD_CHECK_PENDING) return kernel -> checkState == RFC_CONST_DEMOD_CHECK_PASSED ? 0 : -1;
+
+    if(!kernel -> valid) {
+        kernel -> checkState = RFC_CONST_DEMOD_CHECK_FAILED;
+        return -1;
+    }
+
+    /* compare the I/Q vectors */
+    var_ref = sqrt(data -> avgDataI * data -> avgDataI + data -> avgDataQ * data -> avgDataQ);
+    if(var_ref < RFC_CONST_DEMOD_CHECK_MIN) return -1;
+
+    RFC_func_fastDemodDot(kernel, wfRaw, coefId, &var_I, &var_Q);
+
+    var_err = sqrt((var_I - data -> avgDataI) * (var_I - data -> avgDataI) + (var_Q - data -> avgDataQ) * (var_Q - data -> avgDataQ));
+
+    kernel -> checkState = (var_err <= RFC_CONST_DEMOD_CHECK_TOL * var_ref) ? RFC_CONST_DEMOD_CHECK_PASSED : RFC_CONST_DEMOD_CHECK_FAILED;
+
+    return kernel -> checkState == RFC_CONST_DEMOD_CHECK_PASSED ? 0 : -1;
+}
+
+/**
+ * Get the name of the inner loop implementation
+ */
+const char *RFC_func_fastDemodGetImpl(void)
+{
+    return RFC_demodDotName;
+}
+
@@ -0,0 +1,87 @@
+/****************************************************
+ * RFControl_fastDemod.h
+ *
+ * Header file for the fast demodulation of the RFControl module. For the pulse-pulse feedback only the
+ *   average in the window set by avgStartTime_ns/avgTime_ns is needed, so here only the samples inside
+ *   the window are demodulated and averaged (non-IQ demodulation, RFC_CONST_DEMOD_M cycles in 
+ *   RFC_CONST_DEMOD_N points). The full waveform demodulation for display is done by the diagnostics stage
+ *
+ * The average I/Q is a dot product of the raw samples in the window with the demodulation coefficients
+ *   weighted by 2/L (L is the window length). The weighted vectors are precomputed per channel with
+ *   L + N points starting from coefficient id 0, so for any coefficient id of the first sample, the 
+ *   vectors are used from offset (coefId + startId) % N and only need to be rebuilt when the window or
+ *   the sampling settings change
+ *
+ * The demodulation coefficients used by RFLIB are not visible here, only the firmware non-IQ setting (3 cycles
+ *   in 14 points) is known. So after each rebuild the kernel is checked against the RFLIB average of one pulse,
+ *   and it is only used if both agree. Otherwise the caller keeps using RFLIB until the settings change again
+ *
+ * The inner loop is selected at the first call by the CPU features (AVX2, SSE4.1 or scalar)
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_FAST_DEMOD_H
+#define RF_CONTROL_FAST_DEMOD_H
+
+#include "RFLib_signalProcess.h"
+
+#define RFC_CONST_DEMOD_M               3                   /* non-IQ demodulation, M cycles in N points (119MHz for 25.5MHz) */
+#define RFC_CONST_DEMOD_N               14
+
+#define RFC_CONST_DEMOD_MODE_FULL       0                   /* feedback stage demodulates the full waveform with RFLIB (default) */
+#define RFC_CONST_DEMOD_MODE_WINDOW     1                   /* feedback stage only demodulates the averaging window */
+
+#define RFC_CONST_DEMOD_CHECK_PENDING   0                   /* kernel not yet checked against RFLIB */
+#define RFC_CONST_DEMOD_CHECK_PASSED    1                   /* kernel gives the same average as RFLIB */
+#define RFC_CONST_DEMOD_CHECK_FAILED    2                   /* kernel does not match RFLIB, do not use it with these settings */
+
+#define RFC_CONST_DEMOD_CHECK_TOL       0.01                /* relative error of the I/Q vector accepted by the check */
+#define RFC_CONST_DEMOD_CHECK_MIN       100.0               /* minimum I/Q amplitude (ADC counts) to do the check, no decision for smaller signals */
+
+#ifndef RFC_CONST_WF_PNO
+#define RFC_CONST_WF_PNO 1024
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Precomputed window-weighted coefficients of a channel
+ */
+typedef struct {
+    /* settings used to build the vectors, rebuild if any of them changes */
+    double avgStartTime_ns;
+    double avgTime_ns;
+    double sampleFreq_MHz;
+    double sampleDelay_ns;
+    long   pointNum;
+
+    /* window and weighted coefficients */
+    int    valid;                                                           /* 1 if the vectors are built for a non-empty window */
+    long   startId;                                                         /* index of the first sample in the window */
+    long   len;                                                             /* window length, same as the RFLIB average */
+    int    checkState;                                                      /* RFC_CONST_DEMOD_CHECK_PENDING, _PASSED or _FAILED */
+    double wCos[RFC_CONST_WF_PNO + RFC_CONST_DEMOD_N];                      /*  2/L * cos(2*pi*M*k/N) */
+    double wSin[RFC_CONST_WF_PNO + RFC_CONST_DEMOD_N];                      /* -2/L * sin(2*pi*M*k/N) */
+} RFC_struc_demodKernel;
+
+/*======================================
+ * Routines
+ *======================================*/
+void RFC_func_fastDemodInit(RFC_struc_demodKernel *kernel);
+int  RFC_func_fastDemodAvg(RFC_struc_demodKernel *kernel, RFLIB_struc_RFWaveform *data, const short *wfRaw, long coefId);
+int  RFC_func_fastDemodCheck(RFC_struc_demodKernel *kernel, const RFLIB_struc_RFWaveform *data, const short *wfRaw, long coefId);
+
+const char *RFC_func_fastDemodGetImpl(void);                                /* name of the inner loop implementation in use */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
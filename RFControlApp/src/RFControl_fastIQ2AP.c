@@ -0,0 +1,117 @@
+/****************************************************
+ * RFControl_fastIQ2AP.c
+ *
+ * Source file for the fast I/Q to amplitude/phase conversion of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <math.h>
+
+#include "RFControl_fastIQ2AP.h"
+
+/*======================================
+ * Private Data and Routines
+ *======================================*/
+#define RFC_CONST_IQ2AP_RAD2DEG         (180.0 / M_PI)
+#define RFC_CONST_IQ2AP_ERR_MEA_PNO     36000               /* number of angles for the error measurement */
+
+/**
+ * Polynomial atan2 in radian, for |error| < 1.15e-5 rad. Branch-free so that it can be inlined into vectorized loops
+ */
+static inline double RFC_func_fastAtan2(double y, double x)
+{
+    double ax = fabs(x);
+    double ay = fabs(y);
+    double mx = ax > ay ? ax : ay;
+    double mn = ax > ay ? ay : ax;
+    double t  = mn / (mx + (mx == 0));                      /* t in [0, 1], 0 for the origin */
+    double t2 = t * t;
+    double r  = t * (0.9998660 + t2 * (-0.3302995 + t2 * (0.1801410 + t2 * (-0.0851330 + t2 * 0.0208351))));
+
+    r = ay > ax ? M_PI_2 - r : r;                           /* fold back the octants */
+    r = x  < 0  ? M_PI   - r : r;
+    r = y  < 0  ? -r         : r;
+
+    return r;
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Convert the demodulated I/Q waveforms to amplitude and phase, the amplitude is scaled with ampScale and the 
+ *   phase is offset with phaOffset_deg (same as the window averages of the fast demodulation)
+ * Input:
+ *     data             : The RF data, should already been demodulated
+ *     exact            : 1 to use libm atan2, 0 to use the polynomial
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_fastIQ2AP(RFLIB_struc_RFWaveform *data, int exact)
+{
+    long   i;
+    long   var_pno;
+    double var_I, var_Q, var_pha_deg;
+    double var_ampScale;
+    double var_phaOffset_deg;
+
+    /* Check the input */
+    if(!data || data -> pointNum <= 0) return -1;
+
+    var_pno           = data -> pointNum;
+    var_ampScale      = data -> ampScale;
+    var_phaOffset_deg = data -> phaOffset_deg;
+
+    if(exact) {
+        for(i = 0; i < var_pno; i ++) {
+            var_I       = data -> wfI[i];
+            var_Q       = data -> wfQ[i];
+            var_pha_deg = atan2(var_Q, var_I) * RFC_CONST_IQ2AP_RAD2DEG + var_phaOffset_deg;
+
+            if(var_pha_deg >  180) var_pha_deg -= 360;
+            if(var_pha_deg < -180) var_pha_deg += 360;
+
+            data -> wfAmp[i]     = sqrt(var_I * var_I + var_Q * var_Q) * var_ampScale;
+            data -> wfPha_deg[i] = var_pha_deg;
+        }
+    } else {
+        for(i = 0; i < var_pno; i ++) {
+            var_I       = data -> wfI[i];
+            var_Q       = data -> wfQ[i];
+            var_pha_deg = RFC_func_fastAtan2(var_Q, var_I) * RFC_CONST_IQ2AP_RAD2DEG + var_phaOffset_deg;
+            var_pha_deg = var_pha_deg - 360 * (var_pha_deg >  180) + 360 * (var_pha_deg < -180);
+
+            data -> wfAmp[i]     = sqrt(var_I * var_I + var_Q * var_Q) * var_ampScale;
+            data -> wfPha_deg[i] = var_pha_deg;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Measure the maximum phase error of the polynomial compared to libm atan2 over the full circle
+ * Return:
+ *     maximum error in degree
+ */
+double RFC_func_fastIQ2APMeaErr_deg(void)
+{
+    int    i;
+    double var_ang;
+    double var_err;
+    double var_maxErr = 0;
+
+    for(i = 0; i < RFC_CONST_IQ2AP_ERR_MEA_PNO; i ++) {
+        var_ang = 2.0 * M_PI * i / RFC_CONST_IQ2AP_ERR_MEA_PNO - M_PI;
+        var_err = fabs(RFC_func_fastAtan2(sin(var_ang), cos(var_ang)) - atan2(sin(var_ang), cos(var_ang)));
+
+        if(var_err > M_PI) var_err = 2.0 * M_PI - var_err;  /* the +-pi boundary */
+        if(var_err > var_maxErr) var_maxErr = var_err;
+    }
+
+    return var_maxErr * RFC_CONST_IQ2AP_RAD2DEG;
+}
+
@@ -0,0 +1,44 @@
+/****************************************************
+ * RFControl_fastIQ2AP.h
+ *
+ * Header file for the fast I/Q to amplitude/phase conversion of the RFControl module. The conversion
+ *   loop is branch-free so that it can be vectorized by the compiler, the atan2 is done with the
+ *   polynomial of Abramowitz & Stegun 4.4.47 on [0, 1] plus octant folding, the amplitude with sqrt
+ *   (exact). The errno and trapping math are switched off for this file in the Makefile so that GCC can
+ *   if-convert and vectorize the loop. Built without these flags the results are the same, but the loop
+ *   stays scalar
+ *
+ *   The conversion is opt-in, the module uses the RFLIB conversion until DIAG_IQ2AP_MODE is set to EXACT
+ *   or FAST. It is done for every pulse in the diagnostics thread
+ *
+ *   Error bound of the phase: 1.15e-5 rad (6.6e-4 degree) for the polynomial, the actual maximum error
+ *   compared to libm atan2 is measured at init and shown in a PV
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_FAST_IQ2AP_H
+#define RF_CONTROL_FAST_IQ2AP_H
+
+#include "RFLib_signalProcess.h"
+
+#define RFC_CONST_IQ2AP_MODE_RFLIB      0                   /* RFLIB conversion (default, the two below are opt-in via DIAG_IQ2AP_MODE) */
+#define RFC_CONST_IQ2AP_MODE_EXACT      1                   /* libm atan2/sqrt */
+#define RFC_CONST_IQ2AP_MODE_FAST       2                   /* polynomial atan2 */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Routines
+ *======================================*/
+int    RFC_func_fastIQ2AP(RFLIB_struc_RFWaveform *data, int exact);
+double RFC_func_fastIQ2APMeaErr_deg(void);                                  /* measure the maximum phase error of the fast conversion */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,62 @@
+/****************************************************
+ * RFControl_history.c
+ *
+ * Source file for the recent history buffers of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "RFControl_history.h"
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the history buffer
+ */
+void RFC_func_histInit(RFC_struc_history *hist)
+{
+    if(!hist) return;
+
+    memset((void *)hist, 0, sizeof(RFC_struc_history));
+}
+
+/**
+ * Push a new point into the history buffer, the oldest one will be overwritten
+ */
+void RFC_func_histPush(RFC_struc_history *hist, double data)
+{
+    if(!hist) return;
+
+    hist -> buf[hist -> head & (RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1)] = data;
+
+    __sync_synchronize();
+    hist -> head ++;
+}
+
+/**
+ * Copy the ring buffer into the publish buffer in time order (oldest first, latest at the end). 
+ *   The head is sampled once, so the view is consistent except for the points written during the copy,
+ *   which is fine for the diagnostics
+ */
+void RFC_func_histLinearize(RFC_struc_history *hist)
+{
+    unsigned long var_head;
+    unsigned long var_pos;
+    unsigned long var_tailLen;
+
+    if(!hist) return;
+
+    var_head    = hist -> head;
+    __sync_synchronize();
+
+    var_pos     = var_head & (RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1);          /* position of the oldest point */
+    var_tailLen = RFC_CONST_RECENT_HISTORY_BUF_DEPTH - var_pos;
+
+    memcpy((void *)hist -> pub,               (void *)(hist -> buf + var_pos), sizeof(double) * var_tailLen);
+    memcpy((void *)(hist -> pub + var_tailLen), (void *)hist -> buf,           sizeof(double) * var_pos);
+}
+
@@ -0,0 +1,43 @@
+/****************************************************
+ * RFControl_history.h
+ *
+ * Header file for the recent history buffers of the RFControl module. The history is written per pulse
+ *   into a ring buffer (O(1) per pulse), and only converted to the time-ordered view when the waveform
+ *   record is read (into a separate publish buffer)
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_HISTORY_H
+#define RF_CONTROL_HISTORY_H
+
+#ifndef RFC_CONST_RECENT_HISTORY_BUF_DEPTH
+#define RFC_CONST_RECENT_HISTORY_BUF_DEPTH 8192             /* must be power of 2 */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+typedef struct {
+    double buf[RFC_CONST_RECENT_HISTORY_BUF_DEPTH];         /* ring buffer, written by the worker thread */
+    double pub[RFC_CONST_RECENT_HISTORY_BUF_DEPTH];         /* time-ordered view (oldest first) for the waveform record */
+    volatile unsigned long head;                            /* number of points pushed, the next point goes to head % depth */
+} RFC_struc_history;
+
+/*======================================
+ * Routines
+ *======================================*/
+void RFC_func_histInit(RFC_struc_history *hist);
+void RFC_func_histPush(RFC_struc_history *hist, double data);                   /* called per pulse */
+void RFC_func_histLinearize(RFC_struc_history *hist);                           /* called when reading the waveform */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
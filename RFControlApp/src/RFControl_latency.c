@@ -0,0 +1,145 @@
+/****************************************************
+ * RFControl_latency.c
+ *
+ * Source file for the latency histogram of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "RFControl_latency.h"
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Get the bin index of a value
+ */
+static int RFC_func_latGetBinId(unsigned long value_ns)
+{
+    int msb;
+    int exp;
+    int binId;
+
+    /* linear range */
+    if(value_ns < (1UL << RFC_CONST_LAT_SUB_BITS)) return (int)value_ns;
+
+    /* logarithmic range, keep RFC_CONST_LAT_SUB_BITS significant bits */
+    msb   = (int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl(value_ns);
+    exp   = msb - RFC_CONST_LAT_SUB_BITS + 1;
+    binId = (1 << RFC_CONST_LAT_SUB_BITS) + (exp - 1) * (1 << (RFC_CONST_LAT_SUB_BITS - 1)) +
+            (int)(value_ns >> exp) - (1 << (RFC_CONST_LAT_SUB_BITS - 1));
+
+    if(binId >= RFC_CONST_LAT_BIN_NUM) binId = RFC_CONST_LAT_BIN_NUM - 1;
+
+    return binId;
+}
+
+/**
+ * Get the lower edge of a bin in ns
+ */
+static double RFC_func_latGetBinEdge_ns(int binId)
+{
+    int exp;
+    int sub;
+
+    if(binId < (1 << RFC_CONST_LAT_SUB_BITS)) return (double)binId;
+
+    exp = (binId - (1 << RFC_CONST_LAT_SUB_BITS)) / (1 << (RFC_CONST_LAT_SUB_BITS - 1)) + 1;
+    sub = (binId - (1 << RFC_CONST_LAT_SUB_BITS)) % (1 << (RFC_CONST_LAT_SUB_BITS - 1)) + (1 << (RFC_CONST_LAT_SUB_BITS - 1));
+
+    return (double)sub * (double)(1UL << exp);
+}
+
+/**
+ * Get the value (upper edge of the bin, so the result is conservative) for a percentile
+ */
+static double RFC_func_latGetPercentile_us(RFC_struc_latencyHist *hist, long totalCnt, double percent)
+{
+    int  i;
+    long var_sum    = 0;
+    long var_target = (long)(totalCnt * percent / 100.0 + 0.5);
+
+    if(totalCnt <= 0) return 0;
+    if(var_target < 1) var_target = 1;
+
+    for(i = 0; i < RFC_CONST_LAT_BIN_NUM - 1; i ++) {
+        var_sum += hist -> bin[i];
+        if(var_sum >= var_target) return hist -> binEdge_us[i + 1];
+    }
+
+    return hist -> max_us;                                  /* in the overflow bin */
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the histogram
+ */
+void RFC_func_latInit(RFC_struc_latencyHist *hist)
+{
+    int i;
+
+    if(!hist) return;
+
+    memset((void *)hist, 0, sizeof(RFC_struc_latencyHist));
+
+    for(i = 0; i < RFC_CONST_LAT_BIN_NUM; i ++)
+        hist -> binEdge_us[i] = RFC_func_latGetBinEdge_ns(i) / 1000.0;
+}
+
+/**
+ * Record the latency of a pulse. Only called by the main thread, the reset request is also executed here
+ *   so that there is no race between the reset and the recording
+ */
+void RFC_func_latRecord(RFC_struc_latencyHist *hist, unsigned long latency_ns)
+{
+    double var_latency_us = latency_ns / 1000.0;
+
+    if(!hist) return;
+
+    if(hist -> resetRequest) {
+        memset((void *)hist -> bin, 0, sizeof(long) * RFC_CONST_LAT_BIN_NUM);
+        hist -> totalCnt     = 0;
+        hist -> max_us       = 0;
+        hist -> resetRequest = 0;
+    }
+
+    hist -> bin[RFC_func_latGetBinId(latency_ns)] ++;
+    hist -> totalCnt ++;
+
+    if(var_latency_us > hist -> max_us) hist -> max_us = var_latency_us;
+}
+
+/**
+ * Calculate the percentiles
+ */
+void RFC_func_latCalcPercentiles(RFC_struc_latencyHist *hist)
+{
+    long var_totalCnt;
+
+    if(!hist) return;
+
+    var_totalCnt    = hist -> totalCnt;
+
+    hist -> p50_us  = RFC_func_latGetPercentile_us(hist, var_totalCnt, 50.0);
+    hist -> p99_us  = RFC_func_latGetPercentile_us(hist, var_totalCnt, 99.0);
+    hist -> p999_us = RFC_func_latGetPercentile_us(hist, var_totalCnt, 99.9);
+}
+
+/**
+ * Get the monotonic time in ns
+ */
+double RFC_func_latGetTime_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
@@ -0,0 +1,59 @@
+/****************************************************
+ * RFControl_latency.h
+ *
+ * Header file for the latency histogram of the RFControl module. The latency from the IRQ
+ *   returning to the phase correction being applied is recorded per pulse into a fixed memory
+ *   log-linear histogram:
+ *     - values below 2^RFC_CONST_LAT_SUB_BITS ns are counted with 1 ns bins
+ *     - above it, each power of 2 is split into 2^(RFC_CONST_LAT_SUB_BITS-1) bins, so the relative
+ *       resolution is better than 1/16 for all values
+ *   The histogram covers up to 2^(RFC_CONST_LAT_SUB_BITS + RFC_CONST_LAT_MAG_NUM) ns (2^29 ns, about 537 ms),
+ *   the values larger than the range are counted in the last bin. The last bin starts at 31 * 2^24 ns (about
+ *   520 ms), the percentiles falling into it are reported as the maximum latency instead of a bin edge
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_LATENCY_H
+#define RF_CONTROL_LATENCY_H
+
+#define RFC_CONST_LAT_SUB_BITS          5                   /* 32 linear bins, then 16 bins per power of 2 */
+#define RFC_CONST_LAT_MAG_NUM           24                  /* number of powers of 2 covered above the linear range (up to 2^29 ns, 537 ms) */
+#define RFC_CONST_LAT_BIN_NUM           ((1 << RFC_CONST_LAT_SUB_BITS) + RFC_CONST_LAT_MAG_NUM * (1 << (RFC_CONST_LAT_SUB_BITS - 1)))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+typedef struct {
+    volatile long   bin[RFC_CONST_LAT_BIN_NUM];             /* counts of each bin (written by the main thread only) */
+    double          binEdge_us[RFC_CONST_LAT_BIN_NUM];      /* lower edge of each bin in us, for display */
+
+    volatile long   totalCnt;                               /* total number of recorded pulses */
+    volatile double max_us;                                 /* maximum latency in us */
+
+    volatile unsigned short resetRequest;                   /* set by the reset PV, executed by the main thread */
+
+    volatile double p50_us;                                 /* percentiles, calculated when the PVs are read */
+    volatile double p99_us;
+    volatile double p999_us;
+} RFC_struc_latencyHist;
+
+/*======================================
+ * Routines
+ *======================================*/
+void   RFC_func_latInit(RFC_struc_latencyHist *hist);
+void   RFC_func_latRecord(RFC_struc_latencyHist *hist, unsigned long latency_ns);          /* called by the main thread per pulse */
+void   RFC_func_latCalcPercentiles(RFC_struc_latencyHist *hist);                           /* called when reading the PVs */
+
+double RFC_func_latGetTime_ns(void);                                                        /* monotonic time stamp in ns */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
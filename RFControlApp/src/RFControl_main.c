@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 
 #include "perfMeasure.h"
 
@@ -61,6 +62,125 @@ static int RFC_func_getRFData(RFC_struc_moduleData *arg, RFLIB_struc_RFWaveform
                                                       &data -> demodCoefIdCur);
 }
 
+/**
+ * Get the raw ADC data of a feedback channel into the private waveform of the main thread, used when only the
+ *   window is demodulated in the feedback stage (the RF waveform buffers are then owned by the worker thread)
+ */
+static int RFC_func_getFbRawData(RFC_struc_moduleData *arg, RFLIB_struc_RFWaveform *data, int fbChId)
+{
+    int status;
+
+    /* Check the input */
+    if(!arg || !data || fbChId < 0 || fbChId >= RFC_CONST_FB_CH_NUM) return -1;
+
+    /* Get the data */   
+    arg -> fb_wfRawPtr[fbChId] = data -> wfRaw;
+
+    status = RFCFW_API_getADCData(arg -> firmwareModule, data -> chId, 
+                                                         data -> wfRaw, 
+                                                        &data -> sampleFreq_MHz,
+                                                        &data -> sampleDelay_ns,
+                                                        &data -> pointNum,
+                                                        &arg -> fb_demodCoefIdCur[fbChId]);
+
+    if(status != 0) memset((void *)data -> wfRaw, 0, sizeof(short) * RFC_CONST_WF_PNO);
+
+    return status;
+}
+
+/**
+ * Get the raw ADC data of a channel into a slot of the pipeline, together with its sampling settings. Only
+ *   the channel id is read from the RF waveform, which belongs to the worker thread. If the data can not be
+ *   read, the raw data is cleared, so that the slot never carries the data of an older pulse with the stamp
+ *   of this one
+ */
+static int RFC_func_getRawData(RFC_struc_moduleData *arg, unsigned long adcChId, RFC_struc_pulseData *slot, int chId)
+{
+    int status;
+
+    /* Check the input */
+    if(!arg || !slot || chId < 0 || chId >= RFC_CONST_PIPE_CH_NUM) return -1;
+
+    /* Get the data */   
+    status = RFCFW_API_getADCData(arg -> firmwareModule, adcChId, 
+                                                         slot -> wfRaw[chId], 
+                                                        &slot -> sampleFreq_MHz[chId],
+                                                        &slot -> sampleDelay_ns[chId],
+                                                        &slot -> pointNum[chId],
+                                                        &slot -> demodCoefIdCur[chId]);
+
+    if(status != 0) memset((void *)slot -> wfRaw[chId], 0, sizeof(short) * RFC_CONST_WF_PNO);
+
+    return status;
+}
+
+/**
+ * Put the raw ADC data kept in a slot of the pipeline back to the RF waveform
+ */
+static int RFC_func_putRawData(RFLIB_struc_RFWaveform *data, RFC_struc_pulseData *slot, int chId)
+{
+    /* Check the input */
+    if(!data || !slot || chId < 0 || chId >= RFC_CONST_PIPE_CH_NUM) return -1;
+
+    memcpy((void *)data -> wfRaw, (void *)slot -> wfRaw[chId], sizeof(short) * RFC_CONST_WF_PNO);
+    data -> sampleFreq_MHz = slot -> sampleFreq_MHz[chId];
+    data -> sampleDelay_ns = slot -> sampleDelay_ns[chId];
+    data -> pointNum       = slot -> pointNum[chId];
+    data -> demodCoefIdCur = slot -> demodCoefIdCur[chId];
+
+    return 0;
+}
+
+/**
+ * Put the window average of a feedback channel kept in a slot of the pipeline to the RF waveform, so that
+ *   the diagnostics show exactly the values used by the feedback of that pulse
+ */
+static int RFC_func_putAvgData(RFLIB_struc_RFWaveform *data, RFC_struc_pulseData *slot, int chId)
+{
+    /* Check the input */
+    if(!data || !slot || chId < 0 || chId >= RFC_CONST_PIPE_CH_NUM) return -1;
+
+    data -> avgDataI       = slot -> avgDataI[chId];
+    data -> avgDataQ       = slot -> avgDataQ[chId];
+    data -> avgDataAmp     = slot -> avgDataAmp[chId];
+    data -> avgDataPha_deg = slot -> avgDataPha_deg[chId];
+
+    return 0;
+}
+
+/**
+ * Put the demodulated waveform of a feedback channel to the RF waveform. In FULL mode the feedback stage already
+ *   demodulated the whole waveform and handed it over in the slot, only in WINDOW mode it needs to be done here
+ */
+static int RFC_func_putDemodData(RFLIB_struc_RFWaveform *data, RFC_struc_pulseData *slot, int chId)
+{
+    int var_fbChId = chId - RFC_CONST_PIPE_CH_REF;
+
+    /* Check the input */
+    if(!data || !slot || var_fbChId < 0 || var_fbChId >= RFC_CONST_PIPE_FB_CH_NUM) return -1;
+
+    if(slot -> demodMode != RFC_CONST_DEMOD_MODE_FULL) 
+        return RFLIB_RFWaveformDemod(data);
+
+    memcpy((void *)data -> wfI, (void *)slot -> fbWfI[var_fbChId], sizeof(short) * RFC_CONST_WF_PNO);
+    memcpy((void *)data -> wfQ, (void *)slot -> fbWfQ[var_fbChId], sizeof(short) * RFC_CONST_WF_PNO);
+
+    return 0;
+}
+
+/**
+ * Take the settings of a feedback channel (set by the PVs of the RF waveform) into the working waveform of the main thread
+ */
+static void RFC_func_getFbSettings(const RFLIB_struc_RFWaveform *src, RFLIB_struc_RFWaveform *dst)
+{
+    dst -> chId            = src -> chId;
+    dst -> valid           = src -> valid;
+    dst -> avgStartTime_ns = src -> avgStartTime_ns;
+    dst -> avgTime_ns      = src -> avgTime_ns;
+    dst -> ampScale        = src -> ampScale;
+    dst -> phaOffset_deg   = src -> phaOffset_deg;
+}
+
 /**
  * Process the RF data. Demodulate it, then calculate the averaged I/Q/A/P. The average
  *   start point and end point should be set via the EPICS PVs
@@ -106,30 +226,28 @@ static int RFC_func_IQ2AP(RFLIB_struc_RFWaveform *data)
 }
 
 /**
- * Get an analog data, first get the raw data, then convert to physical unit and average
+ * Handle an analog data kept in a slot of the pipeline, first get the raw data, then convert to physical unit and average
  * Input:
- *     arg              : Data structure of the module instance
+ *     slot             : Pulse data in the pipeline
+ *     chId             : Channel index in the pulse data
  * Output:
- *     data             : The analog data to be filled by the DAQ data
+ *     data             : The analog data to be filled by the raw data
  * Return:
  *     0                : Successful
  *    -1                : Failed 
  */
-static int RFC_func_getAnalogData(RFC_struc_moduleData *arg, RFLIB_struc_analogWaveform *data)
+static int RFC_func_putAnalogData(RFLIB_struc_analogWaveform *data, RFC_struc_pulseData *slot, int chId)
 {
     int status = 0;
-    long tmpData;
 
     /* Check the input */
-    if(!arg || !data) return -1;
+    if(!data || !slot || chId < 0 || chId >= RFC_CONST_PIPE_CH_NUM) return -1;
 
-    /* Get the data from the DAQ buffer */       
-    status = RFCFW_API_getADCData(arg -> firmwareModule, data -> chId, 
-                                                         data -> wfRaw, 
-                                                        &data -> sampleFreq_MHz,
-                                                        &data -> sampleDelay_ns,
-                                                        &data -> pointNum,
-                                                        &tmpData);                       /* the demodulation coefficient Id is useless here */
+    /* Get the data from the pipeline */       
+    memcpy((void *)data -> wfRaw, (void *)slot -> wfRaw[chId], sizeof(short) * RFC_CONST_WF_PNO);
+    data -> sampleFreq_MHz = slot -> sampleFreq_MHz[chId];
+    data -> sampleDelay_ns = slot -> sampleDelay_ns[chId];
+    data -> pointNum       = slot -> pointNum[chId];
 
     /* Scale the raw data to physical unit and average it */
     status += RFLIB_analogWaveformScale(data);
@@ -138,23 +256,33 @@ static int RFC_func_getAnalogData(RFC_struc_moduleData *arg, RFLIB_struc_analogW
     return status;    
 }
 
+/**
+ * Make the channel name of a BSA node, <module>:<wfName>_<suffix>
+ */
+static const char *RFC_func_getBSANodeName(char *buf, const char *moduleName, const char *wfName, const char *suffix)
+{
+    snprintf(buf, SDAQ_CONST_CH_NAME_LEN, "%s:%s%s", moduleName, wfName, suffix);
+    return buf;
+}
+
 /**
  * Create BSA nodes for RF waveform
  */
-static int RFC_func_createBSANode_rfWaveform(RFLIB_struc_RFWaveform *data)
+static int RFC_func_createBSANode_rfWaveform(SDAQ_struc_session *session, const char *moduleName, const char *wfName, RFLIB_struc_RFWaveform *data)
 {
     int status = 0;
+    char var_name[SDAQ_CONST_CH_NAME_LEN];
 
     /* Check the input */
     if(!data) return -1;
 
     /* Create data/waveform node */
-    status += SDAQ_func_createDataNode(&data -> avgDataI);
-    status += SDAQ_func_createDataNode(&data -> avgDataQ);
-    status += SDAQ_func_createDataNode(&data -> avgDataAmp);
-    status += SDAQ_func_createDataNode(&data -> avgDataPha_deg);  
+    status += SDAQ_func_createDataNode(session, &data -> avgDataI,       RFC_func_getBSANodeName(var_name, moduleName, wfName, "_AVG_I"));
+    status += SDAQ_func_createDataNode(session, &data -> avgDataQ,       RFC_func_getBSANodeName(var_name, moduleName, wfName, "_AVG_Q"));
+    status += SDAQ_func_createDataNode(session, &data -> avgDataAmp,     RFC_func_getBSANodeName(var_name, moduleName, wfName, "_AVG_A"));
+    status += SDAQ_func_createDataNode(session, &data -> avgDataPha_deg, RFC_func_getBSANodeName(var_name, moduleName, wfName, "_AVG_P_DEG"));  
 
-    status += SDAQ_func_createWfNode(data -> wfRaw, (int)data -> pointNum);
+    status += SDAQ_func_createWfNode(session, data -> wfRaw, (int)data -> pointNum, RFC_func_getBSANodeName(var_name, moduleName, wfName, "_RAW"));
 
     return status;
 }
@@ -162,22 +290,475 @@ static int RFC_func_createBSANode_rfWaveform(RFLIB_struc_RFWaveform *data)
 /**
  * Create BSA nodes for analog waveform
  */
-static int RFC_func_createBSANode_analogWaveform(RFLIB_struc_analogWaveform *data)
+static int RFC_func_createBSANode_analogWaveform(SDAQ_struc_session *session, const char *moduleName, const char *wfName, RFLIB_struc_analogWaveform *data)
 {
     int status = 0;
+    char var_name[SDAQ_CONST_CH_NAME_LEN];
 
     /* Check the input */
     if(!data) return -1;
 
     /* Create data/waveform node */
-    status += SDAQ_func_createDataNode(&data -> avgData); 
-    status += SDAQ_func_createWfNode(data -> wfRaw, (int)data -> pointNum);
+    status += SDAQ_func_createDataNode(session, &data -> avgData, RFC_func_getBSANodeName(var_name, moduleName, wfName, "_AVG")); 
+    status += SDAQ_func_createWfNode(session, data -> wfRaw, (int)data -> pointNum, RFC_func_getBSANodeName(var_name, moduleName, wfName, "_RAW"));
 
     return status;
 }
 
 /**
- * Main thread of this module
+ * Table of the internal data that can be probed, the index is the value of the probe selection
+ */
+typedef struct {
+    size_t      offset;                                 /* offset of the source data in the module data structure */
+    const char *label;                                  /* status message shown when it is selected */
+} RFC_struc_probeSource;
+
+static const RFC_struc_probeSource RFC_probeSourceTable[] = {
+    {offsetof(RFC_struc_moduleData, diag_phaErr_deg),                    "Pul-pul FB pha err (deg)"},
+    {offsetof(RFC_struc_moduleData, diag_phaAdj_deg),                    "Pul-pul FB pha adj (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_ref.avgDataAmp),              "REF amp"},
+    {offsetof(RFC_struc_moduleData, rfData_ref.avgDataPha_deg),          "REF pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_vmOut.avgDataAmp),            "IQ MOD amp"},
+    {offsetof(RFC_struc_moduleData, rfData_vmOut.avgDataPha_deg),        "IQ MOD pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_klyDrive.avgDataAmp),         "KLY DRV amp"},
+    {offsetof(RFC_struc_moduleData, rfData_klyDrive.avgDataPha_deg),     "KLY DRV pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_klyOut.avgDataAmp),           "KLY OUT amp"},
+    {offsetof(RFC_struc_moduleData, rfData_klyOut.avgDataPha_deg),       "KLY OUT pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_sledOut.avgDataAmp),          "SLED OUT amp"},
+    {offsetof(RFC_struc_moduleData, rfData_sledOut.avgDataPha_deg),      "SLED OUT pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_rf.avgDataAmp),        "ACC RF amp"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_rf.avgDataPha_deg),    "ACC RF pha (deg)"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_beam.avgDataAmp),      "ACC BEAM amp"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_beam.avgDataPha_deg),  "ACC BEAM pha (deg)"},
+    {offsetof(RFC_struc_moduleData, analogData_klyBeamV.avgData),        "KLY HV amp"}
+};
+
+#define RFC_CONST_PROBE_SRC_NUM (long)(sizeof(RFC_probeSourceTable) / sizeof(RFC_struc_probeSource))
+
+/**
+ * Table of the per-pulse scalars with running statistics, the names are used for the PV names
+ */
+typedef struct {
+    size_t      offset;                                 /* offset of the source data in the module data structure */
+    const char *name;
+} RFC_struc_statSource;
+
+static const RFC_struc_statSource RFC_statSourceTable[] = {
+    {offsetof(RFC_struc_moduleData, diag_pha_deg),                       "PHA_VAL"},
+    {offsetof(RFC_struc_moduleData, diag_phaErr_deg),                    "PHA_ERR"},
+    {offsetof(RFC_struc_moduleData, diag_phaAdj_deg),                    "PHA_ADJ"},
+    {offsetof(RFC_struc_moduleData, diag_amp_MV),                        "AMP_VAL"},
+    {offsetof(RFC_struc_moduleData, diag_ampErr_MV),                     "AMP_ERR"},
+    {offsetof(RFC_struc_moduleData, rfData_ref.avgDataAmp),              "WF_REF_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_ref.avgDataPha_deg),          "WF_REF_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_vmOut.avgDataAmp),            "WF_VM_OUT_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_vmOut.avgDataPha_deg),        "WF_VM_OUT_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_klyDrive.avgDataAmp),         "WF_KLY_DRV_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_klyDrive.avgDataPha_deg),     "WF_KLY_DRV_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_klyOut.avgDataAmp),           "WF_KLY_OUT_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_klyOut.avgDataPha_deg),       "WF_KLY_OUT_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_sledOut.avgDataAmp),          "WF_SLED_OUT_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_sledOut.avgDataPha_deg),      "WF_SLED_OUT_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_rf.avgDataAmp),        "WF_ACC_OUT_RF_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_rf.avgDataPha_deg),    "WF_ACC_OUT_RF_AVGP"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_beam.avgDataAmp),      "WF_ACC_OUT_BEAM_AVGA"},
+    {offsetof(RFC_struc_moduleData, rfData_accOut_beam.avgDataPha_deg),  "WF_ACC_OUT_BEAM_AVGP"},
+    {offsetof(RFC_struc_moduleData, analogData_klyBeamV.avgData),        "WF_KLY_BEAM_V_AVG"}
+};
+
+#define RFC_CONST_STAT_SRC_NUM (int)(sizeof(RFC_statSourceTable) / sizeof(RFC_struc_statSource))
+
+/**
+ * Hand the products of this pulse to the diagnostics stage. The DAQ buffers of the firmware and the working
+ *   waveforms of the feedback will be overwritten by the next pulse, so the raw data of all channels and the
+ *   feedback results are copied into the pipeline slot here
+ */
+static void RFC_func_pushPulseData(RFC_struc_moduleData *arg, long pulseCnt, long irqDelayCnt, long demodMode, double irqTime_ns)
+{
+    int i;
+    int var_chId;
+
+    RFLIB_struc_RFWaveform *ptr_fbWf;
+
+    RFC_struc_pulseData *slot = RFC_func_pipeGetFreeSlot(&arg -> pipe);
+
+    /* the worker thread is lagging behind, drop the diagnostics of this pulse (never block the feedback) */
+    if(!slot) return;
+
+    slot -> pulseCnt      = pulseCnt;
+    slot -> irqDelayCnt   = irqDelayCnt;
+    slot -> irqMissingCnt = arg -> IRQMissingCnt;
+    slot -> irqTime_ns    = irqTime_ns;
+    slot -> demodMode     = demodMode;
+
+    slot -> fb_pha_deg    = arg -> fbData.fb_pha_deg;
+    slot -> fb_phaErr_deg = arg -> fbData.fb_phaErr_deg;
+    slot -> fb_phaAdj_deg = arg -> fbData.fb_phaAdj_deg;
+    slot -> fb_amp_MV     = arg -> fbData.fb_amp_MV;
+    slot -> fb_ampErr_MV  = arg -> fbData.fb_ampErr_MV;
+
+    /* the other channels, they may still be transferred by the firmware, but the phase is already applied */
+    RFC_func_getRawData(arg, arg -> rfData_vmOut.chId,        slot, RFC_CONST_PIPE_CH_VM_OUT);
+    RFC_func_getRawData(arg, arg -> rfData_klyDrive.chId,     slot, RFC_CONST_PIPE_CH_KLY_DRV);
+    RFC_func_getRawData(arg, arg -> rfData_klyOut.chId,       slot, RFC_CONST_PIPE_CH_KLY_OUT);
+    RFC_func_getRawData(arg, arg -> rfData_accOut_beam.chId,  slot, RFC_CONST_PIPE_CH_ACC_OUT_BEAM);
+    RFC_func_getRawData(arg, arg -> analogData_klyBeamV.chId, slot, RFC_CONST_PIPE_CH_KLY_BEAM_V);     /* the demodulation coefficient Id is useless here */
+
+    /* the feedback channels, hand over the raw data for the full waveform demodulation and the window average used by the feedback */
+    for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) {
+        ptr_fbWf = &arg -> fb_rfData[i];
+        var_chId = RFC_CONST_PIPE_CH_REF + i;
+
+        memcpy((void *)slot -> wfRaw[var_chId], (const void *)arg -> fb_wfRawPtr[i], sizeof(short) * RFC_CONST_WF_PNO);
+        slot -> demodCoefIdCur[var_chId] = arg -> fb_demodCoefIdCur[i];
+        slot -> sampleFreq_MHz[var_chId] = ptr_fbWf -> sampleFreq_MHz;
+        slot -> sampleDelay_ns[var_chId] = ptr_fbWf -> sampleDelay_ns;
+        slot -> pointNum[var_chId]       = ptr_fbWf -> pointNum;
+
+        slot -> avgDataI[var_chId]       = ptr_fbWf -> avgDataI;
+        slot -> avgDataQ[var_chId]       = ptr_fbWf -> avgDataQ;
+        slot -> avgDataAmp[var_chId]     = ptr_fbWf -> avgDataAmp;
+        slot -> avgDataPha_deg[var_chId] = ptr_fbWf -> avgDataPha_deg;
+
+        /* in FULL mode the whole waveform is already demodulated by the feedback, the worker does not need to do it again */
+        if(demodMode == RFC_CONST_DEMOD_MODE_FULL) {
+            memcpy((void *)slot -> fbWfI[i], (const void *)ptr_fbWf -> wfI, sizeof(short) * RFC_CONST_WF_PNO);
+            memcpy((void *)slot -> fbWfQ[i], (const void *)ptr_fbWf -> wfQ, sizeof(short) * RFC_CONST_WF_PNO);
+        }
+    }
+
+    RFC_func_pipePublish(&arg -> pipe);
+
+    /* wake up the worker thread */
+    if(arg -> diagEvent) epicsEventSignal(arg -> diagEvent);
+}
+
+/**
+ * Convert the I/Q waveforms to amplitude/phase with the conversion selected by DIAG_IQ2AP_MODE. RFLIB is the
+ *   default, the exact and the fast conversions are opt-in
+ */
+static void RFC_func_convIQ2AP(RFLIB_struc_RFWaveform *data, long iq2apMode)
+{
+    if(iq2apMode == RFC_CONST_IQ2AP_MODE_RFLIB) 
+        RFC_func_IQ2AP(data);
+    else
+        RFC_func_fastIQ2AP(data, iq2apMode == RFC_CONST_IQ2AP_MODE_EXACT);
+}
+
+/**
+ * Diagnostics tasks run by the scheduler of the worker thread. The module is the module data, the data
+ *   is the object handled by the task and the pulse is the pipeline slot being handled
+ */
+static void RFC_func_taskIntData(void *module, void *data, void *pulse)
+{
+    RFC_struc_moduleData *arg = (RFC_struc_moduleData *)module;
+
+    RFCFW_API_getIntData(arg -> firmwareModule);                            /* firmware intermediate waveforms */
+}
+
+/**
+ * Per-pulse recorders of the worker thread (feedback error history, probes and running statistics). They are
+ *   O(1) per pulse and done for every pulse, so that no pulse is missing in the histories and the statistics
+ */
+static void RFC_func_recordPulse(RFC_struc_moduleData *arg, RFC_struc_pulseData *slot)
+{
+    RFC_struc_probe *probe;
+    int i;
+
+    RFC_func_histPush(&arg -> fbData.fb_phaErrHist_deg, slot -> fb_phaErr_deg);
+
+    for(i = 0; i < RFC_CONST_PROBE_NUM; i ++) {                             /* the selection is normally already resolved into the source pointer */
+        probe = &arg -> diag_probe[i];
+        if(probe -> probeDataSel != probe -> probeSelCur) RFC_func_selectProbe(arg, i);
+        RFC_func_histPush(&probe -> probeHist, probe -> probeSrc ? *probe -> probeSrc : 0);
+    }
+
+    if(RFC_func_statRecord(&arg -> diag_stats, slot -> irqTime_ns))                  /* publish the windows once per block */
+        EPICSLIB_func_scanIoRequest(arg -> ioscanpvt_stats);
+}
+
+/**
+ * Report a capture that could not be saved
+ */
+static void RFC_func_setWriteFailed(RFC_struc_moduleData *arg, const char *fileName)
+{
+    sprintf(arg -> bsa_sr_statusStr, "failed to save %.200s", fileName);
+}
+
+/**
+ * Report the progress of the SDAQ writer thread with the status string and the percent PV. The
+ *   file is written in the background, so the capture completion does not stall the diagnostics thread
+ */
+static void RFC_func_updateWriteStatus(RFC_struc_moduleData *arg, int *writing, int (*getStatus)(SDAQ_struc_session *, long *), const char *fileName, volatile long *percent)
+{
+    long var_percent = 0;
+
+    switch(getStatus(&arg -> bsa_session, &var_percent)) {
+        case SDAQ_CONST_WRITER_BUSY:
+            *percent = var_percent;
+            sprintf(arg -> bsa_sr_statusStr, "writing %.200s (%ld%%)", fileName, var_percent);
+            break;
+
+        case SDAQ_CONST_WRITER_DONE:
+            *percent = 100;
+            strcpy(arg -> bsa_sr_statusStr, fileName);
+            strcat(arg -> bsa_sr_statusStr, " saved!");
+            *writing = 0;
+            break;
+
+        default:
+            RFC_func_setWriteFailed(arg, fileName);
+            *writing = 0;
+            break;
+    }
+}
+
+/**
+ * Check the triggers of the post-mortem buffer. The conditions trigger on the rising edge, so that a 
+ *   condition lasting for many pulses (e.g. RF off) only causes a single dump
+ */
+static void RFC_func_checkPmTrigger(RFC_struc_moduleData *arg, RFC_struc_pulseData *slot, long *condOld, long *irqMissingCntOld)
+{
+    long var_cond = 0;
+    long var_fire;
+
+    if(fabs(slot -> fb_phaErr_deg) >= arg -> fbData.fb_phaErrThreshold_deg)        var_cond |= RFC_CONST_PM_TRIG_PHA_ERR;
+    if(arg -> rfData_sledOut.avgDataAmp >= arg -> fbData.fb_ampLimitHi ||
+       arg -> rfData_sledOut.avgDataAmp <= arg -> fbData.fb_ampLimitLo)            var_cond |= RFC_CONST_PM_TRIG_AMP_LIMIT;
+    if(slot -> irqMissingCnt != *irqMissingCntOld)                                  var_cond |= RFC_CONST_PM_TRIG_IRQ_MISS;
+
+    *irqMissingCntOld = slot -> irqMissingCnt;
+
+    var_fire  = var_cond & ~(*condOld) & arg -> bsa_pmTrigMask;
+    *condOld  = var_cond & ~RFC_CONST_PM_TRIG_IRQ_MISS;                 /* each IRQ missing is an edge by itself */
+
+    if(arg -> bsa_pmTrigger) {                                          /* manual trigger is always enabled */
+        var_fire |= RFC_CONST_PM_TRIG_MANUAL;
+        arg -> bsa_pmTrigger = 0;
+    }
+
+    if(var_fire && SDAQ_func_pmTrigger(&arg -> bsa_session) == 0) {
+        if(var_fire & RFC_CONST_PM_TRIG_PHA_ERR)            strcpy(arg -> bsa_pmLastTrig, "phase error");
+        else if(var_fire & RFC_CONST_PM_TRIG_AMP_LIMIT)     strcpy(arg -> bsa_pmLastTrig, "SLED amplitude limit");
+        else if(var_fire & RFC_CONST_PM_TRIG_IRQ_MISS)      strcpy(arg -> bsa_pmLastTrig, "IRQ missing");
+        else                                                strcpy(arg -> bsa_pmLastTrig, "manual");
+    }
+}
+
+/**
+ * Register the diagnostics tasks (priority, initial cost estimate in us). Only the expensive tasks are scheduled,
+ *   the per-pulse recorders and the waveform processing run unconditionally. The intermediate waveforms are read
+ *   with the single-pass deinterleave, so the task fits into the deadline and runs on every pulse; it is only 
+ *   skipped when the worker is already late
+ */
+static void RFC_func_registerTasks(RFC_struc_moduleData *arg)
+{
+    RFC_struc_sched *sched = &arg -> diag_sched;
+
+    RFC_func_schedAddTask(sched, "INTDATA",       RFC_func_taskIntData, (void *)arg, NULL,                              100, 200);
+}
+
+/**
+ * Worker thread of this module (diagnostics stage). Consume the pulse data handed over by the
+ *   main thread. It runs with a lower priority so that a slow diagnostics pulse never delays
+ *   the phase correction of the next pulse
+ */
+static void RFC_func_diagThread(void *argIn)
+{
+    perfParm_ts *perf_pDiag       = makePerfMeasure("DIAGLOOP",   "diagnostics thread loop time");
+    perfParm_ts *perf_pBSA        = makePerfMeasure("BSA",        "  BSA session");
+
+    perfParm_ts *perf_pDiagTask   = makePerfMeasure("DIAGTASK",   "  scheduled diag. tasks in the diagnostics thread");
+
+    RFC_struc_moduleData *arg = (RFC_struc_moduleData *)argIn;
+    RFC_struc_pulseData  *slot;
+
+    int dataId = -1;                            /* for data BSA */
+    int wfId   = -1;                            /* for waveform BSA */
+    int dataLen = 0;                            /* pulses of the running captures */
+    int wfLen   = 0;
+
+    int dataWriting = 0;                        /* 1 while the captured data is being written by the SDAQ writer thread */
+    int wfWriting   = 0;
+    int saveStatus  = 0;
+
+    long iq2apMode        = RFC_CONST_IQ2AP_MODE_RFLIB;   /* I/Q to amplitude/phase conversion, latched for each pulse */
+
+    long pmCondOld        = 0;                  /* trigger conditions of the last pulse, the post-mortem triggers on the rising edge */
+    long irqMissingCntOld = 0;
+
+    /* Check the input */
+    if(!arg) {
+        printf("RFC_func_diagThread: Illegal thread creation!\n");
+        return;
+    }
+
+    /* Pin to the CPUs and fault in the BSA buffers (written by this thread) before the first pulse */
+    if(arg -> diagThreadCpus[0]) RFC_func_rtSetCpus(arg -> diagThreadCpus);
+    SDAQ_func_prefault(&arg -> bsa_session);
+
+    /* Main loop of the thread */
+    while(1) {
+
+        /* wait for the pulse data from the main thread */
+        epicsEventWait(arg -> diagEvent);
+
+        /* handle all pulses in the pipeline */
+        while((slot = RFC_func_pipeGetFullSlot(&arg -> pipe)) != NULL) {
+            startPerfMeasure(perf_pDiag);
+            /*----------------------------------------------------
+             * HANDLE RF WAVEFORMS FOR BSA
+             *----------------------------------------------------*/ 
+            RFC_func_putRawData(&arg -> rfData_vmOut,       slot, RFC_CONST_PIPE_CH_VM_OUT);
+            RFC_func_putRawData(&arg -> rfData_klyDrive,    slot, RFC_CONST_PIPE_CH_KLY_DRV);
+            RFC_func_putRawData(&arg -> rfData_klyOut,      slot, RFC_CONST_PIPE_CH_KLY_OUT);
+            RFC_func_putRawData(&arg -> rfData_accOut_beam, slot, RFC_CONST_PIPE_CH_ACC_OUT_BEAM);
+
+            RFC_func_putAnalogData(&arg -> analogData_klyBeamV, slot, RFC_CONST_PIPE_CH_KLY_BEAM_V);
+        
+            RFC_func_demodAvgRFData(&arg -> rfData_vmOut);
+            RFC_func_demodAvgRFData(&arg -> rfData_klyDrive);
+            RFC_func_demodAvgRFData(&arg -> rfData_klyOut);
+            RFC_func_demodAvgRFData(&arg -> rfData_accOut_beam);
+
+            /* full waveforms of the feedback channels, the average is the one used by the feedback stage */
+            RFC_func_putRawData(&arg -> rfData_ref,       slot, RFC_CONST_PIPE_CH_REF);
+            RFC_func_putRawData(&arg -> rfData_sledOut,   slot, RFC_CONST_PIPE_CH_SLED_OUT);
+            RFC_func_putRawData(&arg -> rfData_accOut_rf, slot, RFC_CONST_PIPE_CH_ACC_OUT_RF);
+
+            RFC_func_putDemodData(&arg -> rfData_ref,       slot, RFC_CONST_PIPE_CH_REF);
+            RFC_func_putDemodData(&arg -> rfData_sledOut,   slot, RFC_CONST_PIPE_CH_SLED_OUT);
+            RFC_func_putDemodData(&arg -> rfData_accOut_rf, slot, RFC_CONST_PIPE_CH_ACC_OUT_RF);
+
+            RFC_func_putAvgData(&arg -> rfData_ref,       slot, RFC_CONST_PIPE_CH_REF);
+            RFC_func_putAvgData(&arg -> rfData_sledOut,   slot, RFC_CONST_PIPE_CH_SLED_OUT);
+            RFC_func_putAvgData(&arg -> rfData_accOut_rf, slot, RFC_CONST_PIPE_CH_ACC_OUT_RF);
+
+            /* amplitude/phase waveforms of every pulse, so that the saved waveforms always belong to the pulse */
+            iq2apMode = arg -> diag_iq2apMode;
+
+            RFC_func_convIQ2AP(&arg -> rfData_ref,         iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_vmOut,       iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_klyDrive,    iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_klyOut,      iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_sledOut,     iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_accOut_rf,   iq2apMode);
+            RFC_func_convIQ2AP(&arg -> rfData_accOut_beam, iq2apMode);
+
+            /* the feedback results of this pulse, used by the BSA and the probes */
+            arg -> diag_phaErr_deg = slot -> fb_phaErr_deg;
+            arg -> diag_phaAdj_deg = slot -> fb_phaAdj_deg;
+            arg -> diag_pha_deg    = slot -> fb_pha_deg;
+            arg -> diag_amp_MV     = slot -> fb_amp_MV;
+            arg -> diag_ampErr_MV  = slot -> fb_ampErr_MV;
+            arg -> diag_demodMode  = slot -> demodMode;
+
+            /* histories, probes and statistics of this pulse */
+            RFC_func_recordPulse(arg, slot);
+
+            startPerfMeasure(perf_pBSA);
+            /*----------------------------------------------------
+             * PREPARE DATA FOR BSA
+             *----------------------------------------------------*/  
+            /* 120Hz I/O interrupt scanning for old BSA */      
+            EPICSLIB_func_scanIoRequest(arg -> ioscanpvt_120Hz);        
+
+            /* stamp of this pulse saved with the data, to find the missing pulses and align the stations offline. All 
+               SDAQ nodes (rfData_*, analogData_*, diag_*) have been filled from this slot above */
+            SDAQ_func_setPulseStamp(&arg -> bsa_session, (uint64_t)slot -> pulseCnt, (uint64_t)slot -> irqTime_ns);
+
+            /* synchronous data acquisition */
+            if(arg ->  bsa_startDataBSA && dataId < 0) {               /* mechanism to start the data acquisition */
+                dataId = 0;                            
+                arg ->  bsa_startDataBSA = 0;
+            }
+
+            if(dataId >= 0) {
+                saveStatus = SDAQ_func_saveData(&arg -> bsa_session, dataId, arg -> bsa_dataFileName_full);        
+                if(dataId == 0) dataLen = SDAQ_func_getDataCaptureLen(&arg -> bsa_session);  /* latched by the first save */
+                dataId ++;
+                arg -> bsa_dataBSAPercent = (long)(dataId * 100 / dataLen);
+                if(dataId >= dataLen || saveStatus != 0) {
+                    dataId = -1;
+                    if(saveStatus == 0) dataWriting = 1;    /* handed to the writer thread in the last SDAQ_func_saveData */
+                    else                RFC_func_setWriteFailed(arg, arg -> bsa_dataFileName_full);
+                }
+            }  
+
+            if(dataWriting) RFC_func_updateWriteStatus(arg, &dataWriting, SDAQ_func_getDataWriteStatus, arg -> bsa_dataFileName_full, &arg -> bsa_dataBSAPercent);
+
+            /* streaming of the data (only if started by this module) */
+            SDAQ_func_streamSave(&arg -> bsa_session);
+
+            /* post-mortem buffer, record this pulse and check the triggers */
+            if(SDAQ_func_pmSave(&arg -> bsa_session) == 0) RFC_func_checkPmTrigger(arg, slot, &pmCondOld, &irqMissingCntOld);
+
+            /* synchronous waveform acquisition */
+            if(arg ->  bsa_startWfBSA && wfId < 0) {                   /* mechanism to start the waveform acquisition */
+                wfId = 0;                            
+                arg ->  bsa_startWfBSA = 0;
+            }
+
+            if(wfId >= 0) {
+                saveStatus = SDAQ_func_saveWf(&arg -> bsa_session, wfId, arg -> bsa_wfFileName_full);        
+                if(wfId == 0) wfLen = SDAQ_func_getWfCaptureLen(&arg -> bsa_session);
+                wfId ++;
+                arg -> bsa_wfBSAPercent = (long)(wfId * 100 / wfLen);
+                if(wfId >= wfLen || saveStatus != 0) {
+                    wfId = -1;
+                    if(saveStatus == 0) wfWriting = 1;
+                    else                RFC_func_setWriteFailed(arg, arg -> bsa_wfFileName_full);
+                }
+            } 
+
+            if(wfWriting) RFC_func_updateWriteStatus(arg, &wfWriting, SDAQ_func_getWfWriteStatus, arg -> bsa_wfFileName_full, &arg -> bsa_wfBSAPercent);
+
+            endPerfMeasure(perf_pBSA);
+
+            startPerfMeasure(perf_pDiagTask);
+            /*----------------------------------------------------
+             * WAVEFORMS AND OTHER DIAGNOSTICS
+             *----------------------------------------------------*/
+            /* run the tasks fit before the deadline */
+            RFC_func_schedRun(&arg -> diag_sched, slot -> irqTime_ns, (void *)slot);
+
+            endPerfMeasure(perf_pDiagTask);
+
+            /* compile the status vector (continuing)
+             *      bit 0: 1 for firmware/communication failure
+             *      bit 1: 1 for pulse-pulse fb enabled
+             *      bit 2: 1 for pulse-pulse fb failure
+             */
+            arg -> statusVector = 0;
+
+            if((unsigned int)slot -> pulseCnt == 0xFFFFFFFF)                                                /* when firmware is not available, all reading from register is 0xFFFFFFFF */
+                arg -> statusVector += 0x00000001;                                                          
+            else
+                arg -> statusVector &= 0xFFFFFFFE;
+    
+            arg -> statusVector += arg -> fbData.fb_feedbackEnabled     << 1;    
+            arg -> statusVector += arg -> fbData.fb_feedForwardEnabled  << 2;
+            arg -> statusVector += arg -> fbData.fb_refTrackEnabled     << 3;
+
+            if(fabs(slot -> fb_phaErr_deg) >= arg -> fbData.fb_phaErrThreshold_deg)       arg -> statusVector += 1 << 4;
+            if(arg -> rfData_sledOut.avgDataAmp  >= arg -> fbData.fb_ampLimitHi)           arg -> statusVector += 1 << 5;
+            if(arg -> rfData_sledOut.avgDataAmp  <= arg -> fbData.fb_ampLimitLo)           arg -> statusVector += 1 << 6;
+            if(arg -> fbData.fb_phaSLEDWeight > 0)                                         arg -> statusVector += 1 << 7;
+            if(arg -> fbData.fb_phaACCWeight  > 0)                                         arg -> statusVector += 1 << 8;
+
+            /* give the slot back to the main thread */
+            RFC_func_pipeRelease(&arg -> pipe);
+            endPerfMeasure(perf_pDiag);
+        }
+
+        /* stop the thread on request */
+        if(arg -> stopThread) break;
+    }
+}
+
+/**
+ * Main thread of this module (feedback stage). Only the things needed for the pulse-pulse phase 
+ *   correction are done here, all others are handed to the worker thread via the pipeline
  */
 static void RFC_func_mainThread(void *argIn) 
 {
@@ -187,20 +768,15 @@ static void RFC_func_mainThread(void *argIn)
     perfParm_ts *perf_pPhCtrlData = makePerfMeasure("PHCTRLDATA", "    data get for phase control block in the main thread");
     perfParm_ts *perf_pNetDAQ     = makePerfMeasure("NETDAQ",     "      +just net DAQ getting time");
     perfParm_ts *perf_pRFDemo     = makePerfMeasure("RFDEMO",     "      +RF demodulation calc time");
+    perfParm_ts *perf_pNetDAQCh   = makePerfMeasure("NETDAQCH",   "      +net DAQ getting time of one channel (window demodulation)");
+    perfParm_ts *perf_pRFDemoCh   = makePerfMeasure("RFDEMOCH",   "      +RF demodulation calc time of one channel (window demodulation)");
     perfParm_ts *perf_pPhCtrlCalc = makePerfMeasure("PHCTRLCALC", "    calculation for the phase control in the main thread");
-    perfParm_ts *perf_pBSA        = makePerfMeasure("BSA",        "  BSA session");
-
-    perfParm_ts *perf_pWFDiag     = makePerfMeasure("WFDIAG",     "  diag. for waveform in the main thread");
-    perfParm_ts *perf_pOthDiag    = makePerfMeasure("OTHDIAG",    "  diag. for others in the main thread");
+    perfParm_ts *perf_pPipe       = makePerfMeasure("PIPE",       "  hand over the pulse data to the diagnostics thread");
 
     RFC_struc_moduleData *arg = (RFC_struc_moduleData *)argIn;
 
-    int calCnt = 0;                             /* for scheduling the not important calculation */
-
-    int dataId = -1;                            /* for data BSA */
-    int wfId   = -1;                            /* for waveform BSA */
-
     int intId;                                  /* for interrupt pulling */
+    int i;
 
     double phaSetPoint_deg_old = 1e6;           /* for detecting set point changes */
     double phaSetPoint_deg_cal = 0;             /* for error calculation */
@@ -212,8 +788,13 @@ static void RFC_func_mainThread(void *argIn)
 
     long irqDelayCnt  = 0;
 
-    double probeData  = 0;                      /* the probe data */
-    double probeData2 = 0;
+    double irqTime_ns = 0;                      /* time when the IRQ returned, for latency measurement */
+
+    long demodMode    = RFC_CONST_DEMOD_MODE_FULL;  /* demodulation mode of the feedback channels for this pulse */
+
+    RFC_struc_demodKernel  *fbKernel[RFC_CONST_FB_CH_NUM];     /* kernels of the feedback channels for the window demodulation */
+    RFLIB_struc_RFWaveform *fbWf[RFC_CONST_FB_CH_NUM];         /* working waveforms of the feedback channels */
+    RFLIB_struc_RFWaveform *fbWfSet[RFC_CONST_FB_CH_NUM];      /* waveforms holding the settings of the feedback channels */
 
     /* Check the input */
     if(!arg) {
@@ -221,6 +802,21 @@ static void RFC_func_mainThread(void *argIn)
         return;
     }
 
+    /* Pin to the CPUs and fault in the module data (waveforms, histories, pipeline) before the first pulse */
+    if(arg -> threadCpus[0]) RFC_func_rtSetCpus(arg -> threadCpus);
+    RFC_func_rtPrefault((void *)arg, sizeof(RFC_struc_moduleData));
+
+    /* Set up the working data of the feedback channels */
+    fbWfSet[RFC_CONST_FB_CH_REF]      = &arg -> rfData_ref;
+    fbWfSet[RFC_CONST_FB_CH_SLED_OUT] = &arg -> rfData_sledOut;
+    fbWfSet[RFC_CONST_FB_CH_ACC_OUT]  = &arg -> rfData_accOut_rf;
+
+    for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) {
+        fbKernel[i]            = &arg -> fb_demodKernel[i];
+        fbWf[i]                = &arg -> fb_rfData[i];
+        arg -> fb_wfRawPtr[i]  = arg -> fb_rfData[i].wfRaw;
+    }
+
     /* Main loop of the thread */
     while(1) {
 
@@ -231,6 +827,7 @@ static void RFC_func_mainThread(void *argIn)
         intId = RFCFW_API_waitIntr(arg -> firmwareModule);
 
         if(intId == 0) {                                                /* User interrupt occurred */                     
+            irqTime_ns = RFC_func_latGetTime_ns();
         } else {
             epicsThreadSleep(epicsThreadSleepQuantum());
             continue;
@@ -252,28 +849,53 @@ static void RFC_func_mainThread(void *argIn)
          * PHASE CONTROL BLOCK
          *----------------------------------------------------*/ 
         /* Get the RF data */
-        startPerfMeasure(perf_pNetDAQ);
-        RFC_func_getRFData(arg, &arg -> rfData_ref);
-        RFC_func_getRFData(arg, &arg -> rfData_sledOut);                        /* get the SLED data from the DAQ buffer */
-        RFC_func_getRFData(arg, &arg -> rfData_accOut_rf);                      /* get the ACC data from the DAQ buffer */
-        endPerfMeasure(perf_pNetDAQ);
-
-        /* Measure the amplitude and phase in the window */
-        startPerfMeasure(perf_pRFDemo);
-        RFC_func_demodAvgRFData(&arg -> rfData_ref);
-        RFC_func_demodAvgRFData(&arg -> rfData_sledOut);                        
-        RFC_func_demodAvgRFData(&arg -> rfData_accOut_rf);
-        endPerfMeasure(perf_pRFDemo);
+        demodMode = arg -> fbData.fb_demodMode;                                 /* latched for the whole pulse, also handed to the worker with the slot */
+
+        for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) RFC_func_getFbSettings(fbWfSet[i], fbWf[i]);
+
+        if(demodMode == RFC_CONST_DEMOD_MODE_WINDOW) {
+            /* Get and measure the channels one by one, getFbRawData waits only for its own channel, so that a channel
+               is demodulated while the firmware is still transferring the next one (asynchronous ADC reading) */
+            for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) {
+                startPerfMeasure(perf_pNetDAQCh);                               /* the stages are interleaved, so they are measured per channel */
+                RFC_func_getFbRawData(arg, fbWf[i], i);
+                endPerfMeasure(perf_pNetDAQCh);
+
+                startPerfMeasure(perf_pRFDemoCh);
+
+                /* the window is only used after it is checked to give the same average as RFLIB, before that
+                   (or if it does not match the RFLIB coefficients) the channel is demodulated with RFLIB */
+                if(RFC_func_fastDemodAvg(fbKernel[i], fbWf[i], arg -> fb_wfRawPtr[i], arg -> fb_demodCoefIdCur[i]) != 0) {
+                    fbWf[i] -> demodCoefIdCur = arg -> fb_demodCoefIdCur[i];
+                    RFC_func_demodAvgRFData(fbWf[i]);
+                    RFC_func_fastDemodCheck(fbKernel[i], fbWf[i], arg -> fb_wfRawPtr[i], arg -> fb_demodCoefIdCur[i]);
+                }
+                endPerfMeasure(perf_pRFDemoCh);
+            }
+        } else {
+            startPerfMeasure(perf_pNetDAQ);
+            for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) {                         /* get the REF, SLED and ACC data from the DAQ buffer */
+                RFC_func_getRFData(arg, fbWf[i]);
+                arg -> fb_wfRawPtr[i]       = fbWf[i] -> wfRaw;
+                arg -> fb_demodCoefIdCur[i] = fbWf[i] -> demodCoefIdCur;
+            }
+            endPerfMeasure(perf_pNetDAQ);
+
+            /* Measure the amplitude and phase in the window */
+            startPerfMeasure(perf_pRFDemo);
+            for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++) RFC_func_demodAvgRFData(fbWf[i]);
+            endPerfMeasure(perf_pRFDemo);
+        }
 
         endPerfMeasure(perf_pPhCtrlData);
 
         startPerfMeasure(perf_pPhCtrlCalc);
 
         /* Get the effective phase measurement of last RF pulse (combination of SLED, ACC RF and REF) */
-        arg -> fbData.fb_pha_deg = arg -> rfData_sledOut.avgDataPha_deg * arg -> fbData.fb_phaSLEDWeight + arg -> rfData_accOut_rf.avgDataPha_deg * arg -> fbData.fb_phaACCWeight - arg -> fbData.fb_phaOffset_deg;
+        arg -> fbData.fb_pha_deg = fbWf[RFC_CONST_FB_CH_SLED_OUT] -> avgDataPha_deg * arg -> fbData.fb_phaSLEDWeight + fbWf[RFC_CONST_FB_CH_ACC_OUT] -> avgDataPha_deg * arg -> fbData.fb_phaACCWeight - arg -> fbData.fb_phaOffset_deg;
 
         if(arg -> fbData.fb_refTrackEnabled) {
-            arg -> fbData.fb_pha_deg -= arg -> rfData_ref.avgDataPha_deg;
+            arg -> fbData.fb_pha_deg -= fbWf[RFC_CONST_FB_CH_REF] -> avgDataPha_deg;
         }
 
         if(arg -> fbData.fb_pha_deg >  180) arg -> fbData.fb_pha_deg -= 360;                        /* normalize to +-180 range */
@@ -304,13 +926,13 @@ static void RFC_func_mainThread(void *argIn)
         if(arg -> fbData.fb_phaErr_deg < -180) arg -> fbData.fb_phaErr_deg += 360;
 
         /* Get data for monitoring */
-        arg -> fbData.fb_amp_MV     = arg -> rfData_sledOut.avgDataAmp * arg -> fbData.fb_ampScale_1oMV;                             /* we use the SLED output amplitude for amplitude calculation, so we only scale it to MV */
+        arg -> fbData.fb_amp_MV     = fbWf[RFC_CONST_FB_CH_SLED_OUT] -> avgDataAmp * arg -> fbData.fb_ampScale_1oMV;                             /* we use the SLED output amplitude for amplitude calculation, so we only scale it to MV */
         arg -> fbData.fb_ampErr_MV  = arg -> fbData.fb_ampSetPoint_MV - arg -> fbData.fb_amp_MV;
 
         /* Fast feedback, the feedback is independent with the feed forward */
         if((fabs(arg -> fbData.fb_phaErr_deg) < arg -> fbData.fb_phaErrThreshold_deg) &&
-            (arg -> rfData_sledOut.avgDataAmp > arg -> fbData.fb_ampLimitLo) &&
-            (arg -> rfData_sledOut.avgDataAmp < arg -> fbData.fb_ampLimitHi) && (arg -> fbData.fb_feedbackEnabled)) { 
+            (fbWf[RFC_CONST_FB_CH_SLED_OUT] -> avgDataAmp > arg -> fbData.fb_ampLimitLo) &&
+            (fbWf[RFC_CONST_FB_CH_SLED_OUT] -> avgDataAmp < arg -> fbData.fb_ampLimitHi) && (arg -> fbData.fb_feedbackEnabled)) { 
            
             arg -> fbData.fb_phaAdj_deg = arg -> fbData.fb_phaErr_deg * arg -> fbData.fb_phaGain;                                   /* Get the adjustement */
             RFCFW_API_setPha_deg(arg -> firmwareModule, arg -> fbData.fb_phaAdj_deg);                                               /* Apply the adjustement to the firmware */
@@ -325,174 +947,12 @@ static void RFC_func_mainThread(void *argIn)
 
         endPerfMeasure(perf_pPhCtrl);
 
-        /*----------------------------------------------------
-         * HANDLE RF WAVEFORMS FOR BSA
-         *----------------------------------------------------*/ 
-        /* reference signal, SLED out and ACC out rf has been handled above! */
-        RFC_func_getRFData(arg, &arg -> rfData_vmOut);
-        RFC_func_getRFData(arg, &arg -> rfData_klyDrive);
-        RFC_func_getRFData(arg, &arg -> rfData_klyOut);
-        RFC_func_getRFData(arg, &arg -> rfData_accOut_beam);
-        RFC_func_getAnalogData(arg, &arg -> analogData_klyBeamV);
-        
-        RFC_func_demodAvgRFData(&arg -> rfData_vmOut);
-        RFC_func_demodAvgRFData(&arg -> rfData_klyDrive);
-        RFC_func_demodAvgRFData(&arg -> rfData_klyOut);
-        RFC_func_demodAvgRFData(&arg -> rfData_accOut_beam);
+        /* record the latency from the IRQ to the phase actuation (the actuation is done or skipped at this point) */
+        RFC_func_latRecord(&arg -> latHist, (unsigned long)(RFC_func_latGetTime_ns() - irqTime_ns));
 
         /*----------------------------------------------------
-         * PREPARE DATA FOR BSA
-         *----------------------------------------------------*/  
-        /* 120Hz I/O interrupt scanning for old BSA */      
-        EPICSLIB_func_scanIoRequest(arg -> ioscanpvt_120Hz);        
-
-        /* synchronous data acquisition */
-        if(arg ->  bsa_startDataBSA && dataId < 0) {                /* mechanism to start the data acquisition */
-            dataId = 0;                            
-            arg ->  bsa_startDataBSA = 0;
-            SDAQ_func_saveData(dataId, arg -> bsa_dataFileName_full);        
-            dataId ++;
-        }
-
-        if(dataId >= 1) {
-            SDAQ_func_saveData(dataId, arg -> bsa_dataFileName_full);        
-            dataId ++;
-            arg -> bsa_dataBSAPercent = (long)(dataId * 100 / SDAQ_CONST_BUF_SIZE);
-            if(dataId >= SDAQ_CONST_BUF_SIZE) {
-                dataId = -1;
-                strcpy(arg -> bsa_sr_statusStr, arg -> bsa_dataFileName_full);
-                strcat(arg -> bsa_sr_statusStr, " saved!");
-            }
-        }  
-
-        /* synchronous waveform acquisition */
-        if(arg ->  bsa_startWfBSA && wfId < 0) {                    /* mechanism to start the waveform acquisition */
-            wfId = 0;                            
-            arg ->  bsa_startWfBSA = 0;
-            SDAQ_func_saveWf(wfId, arg -> bsa_wfFileName_full);        
-            wfId ++;
-        }
-
-        if(wfId >= 1) {
-            SDAQ_func_saveWf(wfId, arg -> bsa_wfFileName_full);        
-            wfId ++;
-            arg -> bsa_wfBSAPercent = (long)(wfId * 100 / SDAQ_CONST_WF_NUM_SUPPORTED);
-            if(wfId >= SDAQ_CONST_WF_NUM_SUPPORTED) {
-                wfId = -1;
-                strcpy(arg -> bsa_sr_statusStr, arg -> bsa_wfFileName_full);
-                strcat(arg -> bsa_sr_statusStr, " saved!");
-            }
-        } 
-
-        startPerfMeasure(perf_pWFDiag);
-                     
-        /*----------------------------------------------------
-         * WAVEFORMS DIAGNOSTICS
+         * IRQ DIAGNOSTICS
          *----------------------------------------------------*/
-        /* round robin scheduling */
-        switch(calCnt) {
-            case 0:                    
-                /* firmware intermediate waveforms */
-                RFCFW_API_getIntData(arg -> firmwareModule);                
-                break;
-
-            case 1:  RFC_func_IQ2AP(&arg -> rfData_ref);            break;
-            case 2:  RFC_func_IQ2AP(&arg -> rfData_vmOut);          break;
-            case 3:  RFC_func_IQ2AP(&arg -> rfData_klyDrive);       break;
-            case 4:  RFC_func_IQ2AP(&arg -> rfData_klyOut);         break;
-            case 5:  RFC_func_IQ2AP(&arg -> rfData_sledOut);        break;
-            case 6:  RFC_func_IQ2AP(&arg -> rfData_accOut_rf);      break;
-            case 7:  RFC_func_IQ2AP(&arg -> rfData_accOut_beam);    break;           
-            default: break;
-        };
-
-        endPerfMeasure(perf_pWFDiag);
-
-        calCnt ++;
-        if(calCnt > 7) calCnt = 0;
-
-        startPerfMeasure(perf_pOthDiag);
-
-        /*----------------------------------------------------
-         * OTHER DIAGNOSTICS
-         *----------------------------------------------------*/
-        /* the recent history buffer */
-        memcpy((void*)arg -> fbData.fb_phaErrArray_deg, (void *)(arg -> fbData.fb_phaErrArray_deg + 1), sizeof(double) * (RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1));
-        arg -> fbData.fb_phaErrArray_deg[RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1] = arg -> fbData.fb_phaErr_deg;
-
-        /* probe the internal data (two probe data, code is not optimized)*/
-        switch(arg -> diag_probeDataSel) {
-            case 0:  probeData = arg -> fbData.fb_phaErr_deg;               strcpy(arg -> diag_probeStatus, "Pul-pul FB pha err (deg)");    break;
-            case 1:  probeData = arg -> fbData.fb_phaAdj_deg;               strcpy(arg -> diag_probeStatus, "Pul-pul FB pha adj (deg)");    break;
-            case 2:  probeData = arg -> rfData_ref.avgDataAmp;              strcpy(arg -> diag_probeStatus, "REF amp");                     break;
-            case 3:  probeData = arg -> rfData_ref.avgDataPha_deg;          strcpy(arg -> diag_probeStatus, "REF pha (deg)");               break;
-            case 4:  probeData = arg -> rfData_vmOut.avgDataAmp;            strcpy(arg -> diag_probeStatus, "IQ MOD amp");                  break;
-            case 5:  probeData = arg -> rfData_vmOut.avgDataPha_deg;        strcpy(arg -> diag_probeStatus, "IQ MOD pha (deg)");            break;
-            case 6:  probeData = arg -> rfData_klyDrive.avgDataAmp;         strcpy(arg -> diag_probeStatus, "KLY DRV amp");                 break;
-            case 7:  probeData = arg -> rfData_klyDrive.avgDataPha_deg;     strcpy(arg -> diag_probeStatus, "KLY DRV pha (deg)");           break;
-            case 8:  probeData = arg -> rfData_klyOut.avgDataAmp;           strcpy(arg -> diag_probeStatus, "KLY OUT amp");                 break;
-            case 9:  probeData = arg -> rfData_klyOut.avgDataPha_deg;       strcpy(arg -> diag_probeStatus, "KLY OUT pha (deg)");           break;
-            case 10: probeData = arg -> rfData_sledOut.avgDataAmp;          strcpy(arg -> diag_probeStatus, "SLED OUT amp");                break;
-            case 11: probeData = arg -> rfData_sledOut.avgDataPha_deg;      strcpy(arg -> diag_probeStatus, "SLED OUT pha (deg)");          break;
-            case 12: probeData = arg -> rfData_accOut_rf.avgDataAmp;        strcpy(arg -> diag_probeStatus, "ACC RF amp");                  break;
-            case 13: probeData = arg -> rfData_accOut_rf.avgDataPha_deg;    strcpy(arg -> diag_probeStatus, "ACC RF pha (deg)");            break;
-            case 14: probeData = arg -> rfData_accOut_beam.avgDataAmp;      strcpy(arg -> diag_probeStatus, "ACC BEAM amp");                break;
-            case 15: probeData = arg -> rfData_accOut_beam.avgDataPha_deg;  strcpy(arg -> diag_probeStatus, "ACC BEAM pha (deg)");          break;
-            case 16: probeData = arg -> analogData_klyBeamV.avgData;        strcpy(arg -> diag_probeStatus, "KLY HV amp");                  break;
-            default: probeData = 0; strcpy(arg -> diag_probeStatus, "Not supported"); break;
-        }
-
-        switch(arg -> diag_probeDataSel2) {
-            case 0:  probeData2 = arg -> fbData.fb_phaErr_deg;               strcpy(arg -> diag_probeStatus2, "Pul-pul FB pha err (deg)");    break;
-            case 1:  probeData2 = arg -> fbData.fb_phaAdj_deg;               strcpy(arg -> diag_probeStatus2, "Pul-pul FB pha adj (deg)");    break;
-            case 2:  probeData2 = arg -> rfData_ref.avgDataAmp;              strcpy(arg -> diag_probeStatus2, "REF amp");                     break;
-            case 3:  probeData2 = arg -> rfData_ref.avgDataPha_deg;          strcpy(arg -> diag_probeStatus2, "REF pha (deg)");               break;
-            case 4:  probeData2 = arg -> rfData_vmOut.avgDataAmp;            strcpy(arg -> diag_probeStatus2, "IQ MOD amp");                  break;
-            case 5:  probeData2 = arg -> rfData_vmOut.avgDataPha_deg;        strcpy(arg -> diag_probeStatus2, "IQ MOD pha (deg)");            break;
-            case 6:  probeData2 = arg -> rfData_klyDrive.avgDataAmp;         strcpy(arg -> diag_probeStatus2, "KLY DRV amp");                 break;
-            case 7:  probeData2 = arg -> rfData_klyDrive.avgDataPha_deg;     strcpy(arg -> diag_probeStatus2, "KLY DRV pha (deg)");           break;
-            case 8:  probeData2 = arg -> rfData_klyOut.avgDataAmp;           strcpy(arg -> diag_probeStatus2, "KLY OUT amp");                 break;
-            case 9:  probeData2 = arg -> rfData_klyOut.avgDataPha_deg;       strcpy(arg -> diag_probeStatus2, "KLY OUT pha (deg)");           break;
-            case 10: probeData2 = arg -> rfData_sledOut.avgDataAmp;          strcpy(arg -> diag_probeStatus2, "SLED OUT amp");                break;
-            case 11: probeData2 = arg -> rfData_sledOut.avgDataPha_deg;      strcpy(arg -> diag_probeStatus2, "SLED OUT pha (deg)");          break;
-            case 12: probeData2 = arg -> rfData_accOut_rf.avgDataAmp;        strcpy(arg -> diag_probeStatus2, "ACC RF amp");                  break;
-            case 13: probeData2 = arg -> rfData_accOut_rf.avgDataPha_deg;    strcpy(arg -> diag_probeStatus2, "ACC RF pha (deg)");            break;
-            case 14: probeData2 = arg -> rfData_accOut_beam.avgDataAmp;      strcpy(arg -> diag_probeStatus2, "ACC BEAM amp");                break;
-            case 15: probeData2 = arg -> rfData_accOut_beam.avgDataPha_deg;  strcpy(arg -> diag_probeStatus2, "ACC BEAM pha (deg)");          break;
-            case 16: probeData2 = arg -> analogData_klyBeamV.avgData;        strcpy(arg -> diag_probeStatus2, "KLY HV amp");                  break;
-            default: probeData2 = 0; strcpy(arg -> diag_probeStatus2, "Not supported"); break;
-        }
-
-        memcpy((void*)arg -> diag_probeData, (void *)(arg -> diag_probeData + 1), sizeof(double) * (RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1));
-        arg -> diag_probeData[RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1] = probeData;
-
-        memcpy((void*)arg -> diag_probeData2, (void *)(arg -> diag_probeData2 + 1), sizeof(double) * (RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1));
-        arg -> diag_probeData2[RFC_CONST_RECENT_HISTORY_BUF_DEPTH - 1] = probeData2;
-
-        endPerfMeasure(perf_pOthDiag);
-
-        /* compile the status vector (continuing)
-         *      bit 0: 1 for firmware/communication failure
-         *      bit 1: 1 for pulse-pulse fb enabled
-         *      bit 2: 1 for pulse-pulse fb failure
-         */
-        arg -> statusVector = 0;
-
-        if((unsigned int)pulseCnt == 0xFFFFFFFF)                                                        /* when firmware is not available, all reading from register is 0xFFFFFFFF */
-            arg -> statusVector += 0x00000001;                                                          
-        else
-            arg -> statusVector &= 0xFFFFFFFE;
-        
-        arg -> statusVector += arg -> fbData.fb_feedbackEnabled     << 1;    
-        arg -> statusVector += arg -> fbData.fb_feedForwardEnabled  << 2;
-        arg -> statusVector += arg -> fbData.fb_refTrackEnabled     << 3;
-
-        if(fabs(arg -> fbData.fb_phaErr_deg) >= arg -> fbData.fb_phaErrThreshold_deg)  arg -> statusVector += 1 << 4;
-        if(arg -> rfData_sledOut.avgDataAmp  >= arg -> fbData.fb_ampLimitHi)           arg -> statusVector += 1 << 5;
-        if(arg -> rfData_sledOut.avgDataAmp  <= arg -> fbData.fb_ampLimitLo)           arg -> statusVector += 1 << 6;
-        if(arg -> fbData.fb_phaSLEDWeight > 0)                                         arg -> statusVector += 1 << 7;
-        if(arg -> fbData.fb_phaACCWeight  > 0)                                         arg -> statusVector += 1 << 8;
-
         /* check the IRQ missing, including enable the IRQ in the firmware */
         RFCFW_API_meaIntrLatency(arg -> firmwareModule, &irqDelayCnt, &pulseCnt);                       /* get the IRQ delay and trigger counter from firmware */
 
@@ -502,11 +962,21 @@ static void RFC_func_mainThread(void *argIn)
         if(pulseCnt - pulseCnt_old > 1 && pulseCnt_old > 0) arg -> IRQMissingCnt ++;                    /* detect missing IRQ */
         pulseCnt_old = pulseCnt;
 
+        /*----------------------------------------------------
+         * HAND OVER TO THE DIAGNOSTICS STAGE
+         *----------------------------------------------------*/
+        startPerfMeasure(perf_pPipe);
+        RFC_func_pushPulseData(arg, pulseCnt, irqDelayCnt, demodMode, irqTime_ns);
+        endPerfMeasure(perf_pPipe);
+
         /*----------------------------------------------------
          * MISC
          *----------------------------------------------------*/
         /* stop the thread on request */
-        if(arg -> stopThread) break;
+        if(arg -> stopThread) {
+            if(arg -> diagEvent) epicsEventSignal(arg -> diagEvent);                                    /* let the worker thread see the request */
+            break;
+        }
 
         endPerfMeasure(perf_pMain);
     }
@@ -530,6 +1000,8 @@ static void RFC_func_mainThread(void *argIn)
  */
 int RFC_func_createModule(RFC_struc_moduleData *arg, const char *moduleName)
 {
+    int i;
+
     /* Check the input */
     if(!arg || !moduleName || !moduleName[0]) return -1;
 
@@ -539,6 +1011,40 @@ int RFC_func_createModule(RFC_struc_moduleData *arg, const char *moduleName)
     /* Set some necessary inital values */
     strcpy(arg -> moduleName, moduleName);                          /* set the module name */    
     EPICSLIB_func_scanIoInit(&arg -> ioscanpvt_120Hz);              /* init the I/O interrupt scan list */
+    EPICSLIB_func_scanIoInit(&arg -> ioscanpvt_stats);
+
+    RFC_func_pipeInit(&arg -> pipe);                                /* init the pipeline between the two stages */
+    RFC_func_latInit(&arg -> latHist);                              /* init the latency histogram */
+    SDAQ_func_sessionInit(&arg -> bsa_session, moduleName);         /* init the sync DAQ session of this module */
+    for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++)                      /* init the coefficients for the window demodulation */
+        RFC_func_fastDemodInit(&arg -> fb_demodKernel[i]);
+    strcpy(arg -> fb_demodImpl, RFC_func_fastDemodGetImpl());
+    arg -> diag_iq2apErr_deg = RFC_func_fastIQ2APMeaErr_deg();     /* error of the fast I/Q to amplitude/phase conversion */
+
+    RFC_func_schedInit(&arg -> diag_sched);                         /* init the scheduler of the diagnostics tasks */
+    RFC_func_registerTasks(arg);
+    RFC_func_histInit(&arg -> fbData.fb_phaErrHist_deg);            /* init the recent history buffers */
+
+    RFC_func_statInit(&arg -> diag_stats);                          /* init the running statistics */
+    for(i = 0; i < RFC_CONST_STAT_SRC_NUM; i ++)
+        RFC_func_statAdd(&arg -> diag_stats, RFC_statSourceTable[i].name, (volatile double *)((char *)arg + RFC_statSourceTable[i].offset));
+
+    for(i = 0; i < RFC_CONST_PROBE_NUM; i ++) {                     /* init the probes, all select the phase error by default */
+        arg -> diag_probe[i].module = (void *)arg;
+        RFC_func_histInit(&arg -> diag_probe[i].probeHist);
+        RFC_func_selectProbe(arg, i);
+    }
+
+    arg -> diagThreadPriority = -1;                                 /* follow the priority of the local thread by default */
+
+    arg -> bsa_dataChMask     = -1;                                 /* BSA captures, all nodes with the full length */
+    arg -> bsa_dataPulseNum   = SDAQ_CONST_BUF_SIZE;
+    arg -> bsa_wfChMask       = -1;
+    arg -> bsa_wfPulseNum     = SDAQ_CONST_WF_NUM_SUPPORTED;
+
+    arg -> bsa_pmPulseNum     = RFC_CONST_PM_PULSE_NUM;             /* post-mortem buffer, all triggers enabled */
+    arg -> bsa_pmPostNum      = RFC_CONST_PM_POST_NUM;
+    arg -> bsa_pmTrigMask     = RFC_CONST_PM_TRIG_PHA_ERR | RFC_CONST_PM_TRIG_AMP_LIMIT | RFC_CONST_PM_TRIG_IRQ_MISS;
     
     return 0;
 }
@@ -577,6 +1083,9 @@ int RFC_func_destroyModule(RFC_struc_moduleData *arg)
  */ 
 int RFC_func_initModule(RFC_struc_moduleData *arg)
 {
+    char var_name[SDAQ_CONST_CH_NAME_LEN];
+    int  i;
+
     /* check the input */
     if(!arg) return -1;
 
@@ -590,19 +1099,22 @@ int RFC_func_initModule(RFC_struc_moduleData *arg)
     RFLIB_initRFWaveform(&arg -> rfData_accOut_beam,         RFC_CONST_WF_PNO);    
     RFLIB_initAnalogWaveform(&arg -> analogData_klyBeamV,    RFC_CONST_WF_PNO);
 
-    /* init the sync DAQ list */
-    SDAQ_func_createDataNode(&arg -> fbData.fb_phaErr_deg);
-    SDAQ_func_createDataNode(&arg -> fbData.fb_phaAdj_deg);
+    for(i = 0; i < RFC_CONST_FB_CH_NUM; i ++)
+        RFLIB_initRFWaveform(&arg -> fb_rfData[i],           RFC_CONST_WF_PNO);
+
+    /* init the sync DAQ nodes of this module (the names are the same as the PVs), all are the copies of the pulse handled by the worker thread */
+    SDAQ_func_createDataNode(&arg -> bsa_session, &arg -> diag_phaErr_deg, RFC_func_getBSANodeName(var_name, arg -> moduleName, "BSA_PHA_ERR", ""));
+    SDAQ_func_createDataNode(&arg -> bsa_session, &arg -> diag_phaAdj_deg, RFC_func_getBSANodeName(var_name, arg -> moduleName, "BSA_PHA_ADJ", ""));
 
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_ref);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_vmOut);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_klyDrive);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_klyOut);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_sledOut);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_accOut_rf);
-    RFC_func_createBSANode_rfWaveform(&arg -> rfData_accOut_beam);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_REF",          &arg -> rfData_ref);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_VM_OUT",       &arg -> rfData_vmOut);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_KLY_DRV",      &arg -> rfData_klyDrive);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_KLY_OUT",      &arg -> rfData_klyOut);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_SLED_OUT",     &arg -> rfData_sledOut);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_ACC_OUT_RF",   &arg -> rfData_accOut_rf);
+    RFC_func_createBSANode_rfWaveform(&arg -> bsa_session, arg -> moduleName, "WF_ACC_OUT_BEAM", &arg -> rfData_accOut_beam);
 
-    RFC_func_createBSANode_analogWaveform(&arg -> analogData_klyBeamV);
+    RFC_func_createBSANode_analogWaveform(&arg -> bsa_session, arg -> moduleName, "WF_KLY_BEAM_V", &arg -> analogData_klyBeamV);
 
     return 0; 
 }
@@ -655,6 +1167,74 @@ int RFC_func_setThreadPriority(RFC_struc_moduleData *arg, unsigned int priority)
     return 0;
 }
 
+/**
+ * Set the priority of the worker thread for diagnostics
+ * Input:
+ *     arg              : Data structure of the module instance
+ *     priority         : Priority of the thread
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_setDiagThreadPriority(RFC_struc_moduleData *arg, unsigned int priority)
+{
+    /* Check the input */
+    if(!arg || priority > 99) return -1;
+
+    /* Set the priority */
+    arg -> diagThreadPriority = priority;
+
+    /* If the thread exists, change the priority */
+    if(arg -> threadCreated && arg -> diagThread) {
+        EPICSLIB_func_threadSetPriority(arg -> diagThread, priority);        
+    }
+    
+    return 0;
+}
+
+/**
+ * Set the CPU list of the thread, applied when the thread starts
+ * Input:
+ *     arg              : Data structure of the module instance
+ *     cpuStr           : CPU list like "2" or "2-3,6"
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_setThreadCpus(RFC_struc_moduleData *arg, const char *cpuStr)
+{
+    /* Check the input */
+    if(!arg || RFC_func_rtCheckCpus(cpuStr) != 0) return -1;
+
+    /* The affinity can only be set by the thread itself, so it must be set before the thread is created */
+    if(arg -> threadCreated) return -1;
+
+    strcpy(arg -> threadCpus, cpuStr);
+
+    return 0;
+}
+
+/**
+ * Set the CPU list of the worker thread for diagnostics, applied when the thread starts
+ * Input:
+ *     arg              : Data structure of the module instance
+ *     cpuStr           : CPU list like "2" or "2-3,6"
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_setDiagThreadCpus(RFC_struc_moduleData *arg, const char *cpuStr)
+{
+    /* Check the input */
+    if(!arg || RFC_func_rtCheckCpus(cpuStr) != 0) return -1;
+
+    if(arg -> threadCreated) return -1;
+
+    strcpy(arg -> diagThreadCpus, cpuStr);
+
+    return 0;
+}
+
 /**
  * Create and start a thread for this module
  * Input:
@@ -665,7 +1245,10 @@ int RFC_func_setThreadPriority(RFC_struc_moduleData *arg, unsigned int priority)
  */
 int RFC_func_createThread(RFC_struc_moduleData *arg)
 {
-    char buf_threadNameStr[128] = "RFC_thread_";
+    char buf_threadNameStr[128]     = "RFC_thread_";
+    char buf_diagThreadNameStr[128] = "RFC_diag_";
+
+    int var_diagPriority;
 
     /* Check the input */
     if(!arg) return -1;
@@ -673,6 +1256,17 @@ int RFC_func_createThread(RFC_struc_moduleData *arg)
     /* If the thread is already on, simply return */
     if(arg -> threadCreated && arg -> localThread) return 0;
 
+    /* Create the worker thread first, so that it is ready when the first pulse comes */
+    if(!arg -> diagEvent) arg -> diagEvent = epicsEventCreate(epicsEventEmpty);
+    if(!arg -> diagEvent) return -1;
+
+    var_diagPriority = arg -> diagThreadPriority;
+    if(var_diagPriority < 0) var_diagPriority = arg -> threadPriority - RFC_CONST_DIAG_THREAD_PRIO_OFFSET;
+    if(var_diagPriority < 0) var_diagPriority = 0;
+
+    strcat(buf_diagThreadNameStr, arg -> moduleName);
+    arg -> diagThread    = EPICSLIB_func_threadCreate(buf_diagThreadNameStr, var_diagPriority, RFC_func_diagThread, (void *)arg);
+
     /* Create the thread */
     strcat(buf_threadNameStr, arg -> moduleName);
     arg -> localThread   = EPICSLIB_func_threadCreate(buf_threadNameStr, arg -> threadPriority, RFC_func_mainThread, (void *)arg);
@@ -681,17 +1275,38 @@ int RFC_func_createThread(RFC_struc_moduleData *arg)
     return 0;
 }
 
+/**
+ * Resolve the selection of a probe into the pointer of the source data, called when the selection changes
+ *   and by the probe task if the selection was changed without the write callback
+ * Input:
+ *     arg         : Data structure of the module instance
+ *     probeId     : Index of the probe
+ * Return:
+ *     0           : Successful
+ *    -1           : Failed
+ */
+int RFC_func_selectProbe(RFC_struc_moduleData *arg, int probeId)
+{
+    RFC_struc_probe *probe;
+    long sel;
 
+    /* Check the input */
+    if(!arg || probeId < 0 || probeId >= RFC_CONST_PROBE_NUM) return -1;
 
+    probe = &arg -> diag_probe[probeId];
+    sel   = probe -> probeDataSel;
 
+    probe -> probeSelCur = sel;
 
+    /* Resolve the selection */
+    if(sel >= 0 && sel < RFC_CONST_PROBE_SRC_NUM) {
+        probe -> probeSrc = (volatile double *)((char *)arg + RFC_probeSourceTable[sel].offset);
+        strcpy(probe -> probeStatus, RFC_probeSourceTable[sel].label);
+    } else {
+        probe -> probeSrc = NULL;
+        strcpy(probe -> probeStatus, "Not supported");
+    }
 
-
-
-
-
-
-
-
-
+    return 0;
+}
 
@@ -40,14 +40,39 @@
 #ifndef RF_CONTROL_MAIN_H
 #define RF_CONTROL_MAIN_H
 
-#define RFC_CONST_RECENT_HISTORY_BUF_DEPTH 2048
+#define RFC_CONST_RECENT_HISTORY_BUF_DEPTH 8192          /* depth of the recent history buffers, must be power of 2 */
 #define RFC_CONST_WF_PNO 1024                               /* point number of the waveforms */
+#define RFC_CONST_DIAG_THREAD_PRIO_OFFSET 10                /* default priority of the worker thread is this much lower than the local thread */
+#define RFC_CONST_PROBE_NUM 8                               /* number of probes for the internal data */
+
+#define RFC_CONST_FB_CH_NUM      3                          /* channels used by the feedback (REF, SLED out and ACC out RF) */
+#define RFC_CONST_FB_CH_REF      0
+#define RFC_CONST_FB_CH_SLED_OUT 1
+#define RFC_CONST_FB_CH_ACC_OUT  2
+
+#define RFC_CONST_PM_PULSE_NUM   256                        /* default pulses kept by the post-mortem buffer */
+#define RFC_CONST_PM_POST_NUM    32                         /* default pulses recorded after the post-mortem trigger */
+
+#define RFC_CONST_PM_TRIG_PHA_ERR   0x01                    /* post-mortem triggers, bits of the trigger mask and condition */
+#define RFC_CONST_PM_TRIG_AMP_LIMIT 0x02
+#define RFC_CONST_PM_TRIG_IRQ_MISS  0x04
+#define RFC_CONST_PM_TRIG_MANUAL    0x08
+
+#include <epicsEvent.h>
 
 #include "RFLib_signalProcess.h"                            /* use the library data definitions and routines */
 #include "MathLib_dataProcess.h"
 #include "EPICSLib_wrapper.h"
 
 #include "syncDAQ.h"
+#include "RFControl_pipeline.h"
+#include "RFControl_latency.h"
+#include "RFControl_history.h"
+#include "RFControl_fastDemod.h"
+#include "RFControl_fastIQ2AP.h"
+#include "RFControl_sched.h"
+#include "RFControl_stats.h"
+#include "RFControl_rt.h"
 
 #include "RFControl_requiredInterface_fastFeedback.h"       /* interface with the fast feedback */
 #include "RFControlFirmware_availableInterface_api.h"
@@ -90,10 +115,30 @@ typedef struct {
 
     volatile unsigned short fb_refTrackEnabled;             /* put 1 to enable the reference tracking for pulse-pulse feedback */
 
-    double fb_phaErrArray_deg[RFC_CONST_RECENT_HISTORY_BUF_DEPTH];  /* a FIFO to show the recent history of the phase error */        
+    volatile long fb_demodMode;                             /* RFC_CONST_DEMOD_MODE_FULL or RFC_CONST_DEMOD_MODE_WINDOW for the feedback channels */
+
+    RFC_struc_history fb_phaErrHist_deg;                    /* ring buffer to show the recent history of the phase error */
 
 } RFC_struc_feedbackData;
 
+/*======================================
+ * Data structure for the probes
+ *======================================*/
+/**
+ * Data structure for a probe of the internal data. The selection is resolved into a direct pointer to the
+ *   source when the selection PV is written, so only one load and one ring store are needed per pulse. The
+ *   selection can also be set without the write callback (e.g. restored by autosave), so the probe task
+ *   resolves it again when it differs from the resolved one
+ */
+typedef struct {
+    volatile long    probeDataSel;                          /* select the data that you want */
+    volatile long    probeSelCur;                           /* selection that probeSrc is resolved from */
+    volatile double *probeSrc;                              /* resolved source of the selected data, NULL if not supported */
+    RFC_struc_history probeHist;                            /* ring buffer to show the recent history of the selected data */
+    char             probeStatus[128];                      /* status message of the probe */
+    void            *module;                                /* back pointer to the module data, used by the write callback */
+} RFC_struc_probe;
+
 /*======================================
  * Data structure for the RF Control module
  *======================================*/
@@ -112,6 +157,13 @@ typedef struct {
     int stopThread;                                         /* 1 to stop the thread */
     int threadPriority;                                     /* priority of the local thread */   
 
+    EPICSLIB_type_threadId  diagThread;                     /* thread id of the diagnostics stage (worker thread) */
+    epicsEventId diagEvent;                                 /* signal the worker thread that new pulse data is available */
+    int diagThreadPriority;                                 /* priority of the worker thread, should be lower than the local thread */
+
+    char threadCpus[RFC_CONST_RT_CPUS_LEN];                 /* CPU list the local thread is pinned to, empty for no pinning */
+    char diagThreadCpus[RFC_CONST_RT_CPUS_LEN];             /* CPU list the worker thread is pinned to, empty for no pinning */
+
     /* --- status --- */
     volatile long IRQDelayCnt;                              /* IRQ delay counter in clock cycle */
     volatile long IRQCnt;                                   /* IRQ counter */
@@ -119,6 +171,12 @@ typedef struct {
 
     volatile long statusVector;
 
+    /* --- pipeline between the feedback stage and the diagnostics stage --- */
+    RFC_struc_pipeline pipe;
+
+    /* --- latency from the IRQ to the phase actuation --- */
+    RFC_struc_latencyHist latHist;
+
     volatile unsigned short mtcaOn;                         /* to show if MTCA on (for beam acceleration) or not */
 
     /* --- data and access for firmware --- */
@@ -127,7 +185,7 @@ typedef struct {
     /* --- data for phase feedback --- */
     RFC_struc_feedbackData fbData;                          /* phase feedback data */
 
-    /* --- data for raw data measurement and display (directly from ADCs) --- */
+    /* --- data for raw data measurement and display (directly from ADCs), filled by the worker thread from the pipeline --- */
     RFLIB_struc_RFWaveform rfData_ref;                      /* raw data for the RF reference signal */
     RFLIB_struc_RFWaveform rfData_vmOut;                    /* raw data after the vector modulator */
     RFLIB_struc_RFWaveform rfData_klyDrive;                 /* raw data for klystron driving signal */
@@ -137,6 +195,13 @@ typedef struct {
     RFLIB_struc_RFWaveform rfData_accOut_beam;              /* raw data for accelerator output, the beam signal */
     RFLIB_struc_analogWaveform analogData_klyBeamV;         /* sample of a base band signal, the klystron beam voltage */ 
 
+    RFLIB_struc_RFWaveform fb_rfData[RFC_CONST_FB_CH_NUM];  /* working copies of REF, SLED out and ACC out RF for the feedback (only used by the main thread), 
+                                                               the settings are taken from the waveforms above every pulse */
+    const short *fb_wfRawPtr[RFC_CONST_FB_CH_NUM];          /* raw data of the feedback channels of this pulse (in fb_rfData or the RF waveforms) */
+    long  fb_demodCoefIdCur[RFC_CONST_FB_CH_NUM];
+    RFC_struc_demodKernel fb_demodKernel[RFC_CONST_FB_CH_NUM];  /* precomputed window-weighted coefficients of the feedback channels */
+    char  fb_demodImpl[32];                                 /* inner loop implementation of the window demodulation (avx2, sse4.1 or scalar) */
+
     /* --- data BSA and save/restore --- */
     char bsa_sr_folder[EPICSLIB_CONST_PATH_LEN];            /* path for data BSA and save/restore */
     char bsa_sr_statusStr[EPICSLIB_CONST_PATH_LEN];         /* status string */
@@ -150,17 +215,66 @@ typedef struct {
     volatile unsigned short bsa_startDataBSA;               /* 1 to start a data acquisition and save to file */
     volatile unsigned short bsa_startWfBSA;                 /* 1 to start a waveform acquisition and save to file */
 
-    volatile long bsa_dataBSAPercent;                       /* show how much persent the BSA is done */
-    volatile long bsa_wfBSAPercent;                         /* show how much persent the BSA is done */
+    volatile long bsa_dataBSAPercent;                       /* show how much persent the BSA is done (capture, then writing to file) */
+    volatile long bsa_wfBSAPercent;                         /* show how much persent the BSA is done (capture, then writing to file) */
+
+    SDAQ_struc_session bsa_session;                         /* nodes, captures and writer of this module */
+
+    volatile double bsa_poolUsed_MB;                        /* memory of the capture buffer pool (shared by all modules) */
+    volatile double bsa_poolFree_MB;
+
+    volatile unsigned short bsa_compress;                   /* 1 to compress the capture and post-mortem files */
+    volatile double bsa_compressRatio;                      /* raw size / file size of the last compressed file */
+    volatile double bsa_compressSpeed_MBps;                 /* raw data compressed per second for the last compressed file */
+
+    volatile long bsa_dataChMask;                           /* bit i selects the i-th BSA data node (creation order), -1 for all */
+    volatile long bsa_dataPulseNum;                         /* pulses of a data capture */
+    volatile long bsa_wfChMask;                             /* bit i selects the i-th BSA waveform node (creation order), -1 for all */
+    volatile long bsa_wfPulseNum;                           /* pulses of a waveform capture */
+
+    char bsa_streamFileName[EPICSLIB_CONST_NAME_LEN];       /* base name of the streaming files (_NNNN appended) */
+    char bsa_streamFileName_full[EPICSLIB_CONST_PATH_LEN];
+
+    volatile unsigned short bsa_stream;                     /* 1 to start the streaming of the data, 0 to stop */
+    volatile double bsa_streamRotate_MB;                    /* start a new file after this size, 0 for no limit */
+    volatile double bsa_streamRotate_s;                     /* start a new file after this time, 0 for no limit */
+
+    volatile long bsa_streamFillPercent;                    /* fill level of the streaming ring (back pressure of the writer) */
+    volatile long bsa_streamDropCnt;                        /* pulses dropped because the ring was full */
+    volatile long bsa_streamFileCnt;                        /* number of files written */
+
+    char bsa_pmFileName[EPICSLIB_CONST_NAME_LEN];           /* base name of the post-mortem dump files (_NNNN appended) */
+    char bsa_pmFileName_full[EPICSLIB_CONST_PATH_LEN];
+
+    volatile unsigned short bsa_pmEnable;                   /* 1 to enable the post-mortem buffer */
+    volatile long bsa_pmPulseNum;                           /* pulses kept, applied when enabled */
+    volatile long bsa_pmPostNum;                            /* pulses recorded after the trigger, applied when enabled */
+    volatile long bsa_pmTrigMask;                           /* enabled triggers, RFC_CONST_PM_TRIG_xxx */
+    volatile unsigned short bsa_pmTrigger;                  /* 1 to trigger manually */
+
+    volatile long bsa_pmDumpCnt;                            /* number of dumps written */
+    char bsa_pmLastTrig[EPICSLIB_CONST_NAME_LEN];           /* trigger of the last dump */
 
     /* --- diagnostics, probe for internal data --- */
-    volatile long diag_probeDataSel;                            /* select the data that you want */
-    double diag_probeData[RFC_CONST_RECENT_HISTORY_BUF_DEPTH];  /* a FIFO to show the recent history of the selected data */        
-    char diag_probeStatus[128];                                 /* status message of the probe */
+    volatile double diag_phaErr_deg;                        /* feedback results of the pulse processed by the worker thread (probe sources) */
+    volatile double diag_phaAdj_deg;
+    volatile double diag_pha_deg;
+    volatile double diag_amp_MV;
+    volatile double diag_ampErr_MV;
+    volatile long   diag_demodMode;                         /* demodulation mode used by the feedback stage for this pulse */
+
+    RFC_struc_probe diag_probe[RFC_CONST_PROBE_NUM];        /* probes of the internal data */
 
-    volatile long diag_probeDataSel2;                           /* select the data that you want */
-    double diag_probeData2[RFC_CONST_RECENT_HISTORY_BUF_DEPTH]; /* a FIFO to show the recent history of the selected data */        
-    char diag_probeStatus2[128];                                /* status message of the probe */
+    /* --- diagnostics, I/Q to amplitude/phase conversion of the waveforms --- */
+    volatile long diag_iq2apMode;                           /* RFC_CONST_IQ2AP_MODE_RFLIB (default), _EXACT or _FAST */
+    double diag_iq2apErr_deg;                               /* measured maximum phase error of the fast conversion */
+
+    /* --- diagnostics, scheduler of the non-critical tasks in the worker thread --- */
+    RFC_struc_sched diag_sched;
+
+    /* --- diagnostics, running statistics of the per-pulse scalars --- */
+    RFC_struc_stats         diag_stats;
+    EPICSLIB_type_ioScanPvt ioscanpvt_stats;                /* I/O interrupt scanning list, requested when the windows are refreshed */
 
 } RFC_struc_moduleData;
 
@@ -178,8 +292,13 @@ int  RFC_func_initModule(RFC_struc_moduleData *arg);
 int  RFC_func_associateFirmwareModule(RFC_struc_moduleData *arg, const char *firmwareModuleName); /* associate this module with a RFControlFirmware module */
 
 int  RFC_func_setThreadPriority(RFC_struc_moduleData *arg, unsigned int priority);                /* set the priority of the thread */
+int  RFC_func_setDiagThreadPriority(RFC_struc_moduleData *arg, unsigned int priority);            /* set the priority of the worker thread for diagnostics */
+int  RFC_func_setThreadCpus(RFC_struc_moduleData *arg, const char *cpuStr);                     /* set the CPU list of the thread */
+int  RFC_func_setDiagThreadCpus(RFC_struc_moduleData *arg, const char *cpuStr);                 /* set the CPU list of the worker thread for diagnostics */
 int  RFC_func_createThread(RFC_struc_moduleData *arg);                                            /* create a thread for the board ctrl */
 
+int  RFC_func_selectProbe(RFC_struc_moduleData *arg, int probeId);                                /* resolve the selection of a probe into the source pointer */
+
 #ifdef __cplusplus
 }
 #endif
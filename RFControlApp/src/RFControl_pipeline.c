@@ -0,0 +1,92 @@
+/****************************************************
+ * RFControl_pipeline.c
+ *
+ * Source file for the pulse pipeline of the RFControl module (single producer, single consumer ring)
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "RFControl_pipeline.h"
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Memory barrier, make sure the slot content is visible before the index changes
+ */
+#define RFC_func_pipeBarrier() __sync_synchronize()
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the pipeline
+ */
+void RFC_func_pipeInit(RFC_struc_pipeline *pipe)
+{
+    if(!pipe) return;
+
+    pipe -> head    = 0;
+    pipe -> tail    = 0;
+    pipe -> dropCnt = 0;
+}
+
+/**
+ * Get the free slot to be filled by the producer
+ * Return:
+ *     NULL             : The ring is full (the consumer is lagging behind), the pulse should be dropped
+ *     slot address     : Successful
+ */
+RFC_struc_pulseData *RFC_func_pipeGetFreeSlot(RFC_struc_pipeline *pipe)
+{
+    if(!pipe) return NULL;
+
+    if(pipe -> head - pipe -> tail >= RFC_CONST_PIPE_DEPTH) {
+        pipe -> dropCnt ++;
+        return NULL;
+    }
+
+    return &pipe -> slot[pipe -> head & (RFC_CONST_PIPE_DEPTH - 1)];
+}
+
+/**
+ * Publish the slot got by RFC_func_pipeGetFreeSlot
+ */
+void RFC_func_pipePublish(RFC_struc_pipeline *pipe)
+{
+    if(!pipe) return;
+
+    RFC_func_pipeBarrier();
+    pipe -> head ++;
+}
+
+/**
+ * Get the oldest slot filled by the producer
+ * Return:
+ *     NULL             : The ring is empty
+ *     slot address     : Successful
+ */
+RFC_struc_pulseData *RFC_func_pipeGetFullSlot(RFC_struc_pipeline *pipe)
+{
+    if(!pipe) return NULL;
+
+    if(pipe -> head == pipe -> tail) return NULL;
+
+    RFC_func_pipeBarrier();
+    return &pipe -> slot[pipe -> tail & (RFC_CONST_PIPE_DEPTH - 1)];
+}
+
+/**
+ * Release the slot got by RFC_func_pipeGetFullSlot
+ */
+void RFC_func_pipeRelease(RFC_struc_pipeline *pipe)
+{
+    if(!pipe) return;
+
+    RFC_func_pipeBarrier();
+    pipe -> tail ++;
+}
+
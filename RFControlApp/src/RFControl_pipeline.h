@@ -0,0 +1,103 @@
+/****************************************************
+ * RFControl_pipeline.h
+ *
+ * Header file for the pulse pipeline of the RFControl module.
+ *   The main loop is split into two stages:
+ *     - feedback stage    : runs in the IRQ thread, only does the things needed for the phase correction
+ *     - diagnostics stage : runs in a lower priority worker thread, does BSA, diagnostics and the non-critical demodulation
+ *   The products of each pulse are handed from the first stage to the second one via a lock-free ring
+ *   with single producer (IRQ thread) and single consumer (worker thread)
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_PIPELINE_H
+#define RF_CONTROL_PIPELINE_H
+
+#define RFC_CONST_PIPE_DEPTH            8                   /* number of pulses can be buffered between the two stages, must be power of 2 */
+#define RFC_CONST_PIPE_CH_NUM           8                   /* number of channels whose raw data is handed to the diagnostics stage */
+
+#define RFC_CONST_PIPE_CH_VM_OUT        0                   /* slot index of the channels in the pulse data */
+#define RFC_CONST_PIPE_CH_KLY_DRV       1
+#define RFC_CONST_PIPE_CH_KLY_OUT       2
+#define RFC_CONST_PIPE_CH_ACC_OUT_BEAM  3
+#define RFC_CONST_PIPE_CH_KLY_BEAM_V    4
+#define RFC_CONST_PIPE_CH_REF           5                   /* feedback channels, the window average is done by the feedback stage */
+#define RFC_CONST_PIPE_CH_SLED_OUT      6
+#define RFC_CONST_PIPE_CH_ACC_OUT_RF    7
+
+#define RFC_CONST_PIPE_FB_CH_NUM        3                   /* number of feedback channels, starting from RFC_CONST_PIPE_CH_REF */
+
+#ifndef RFC_CONST_WF_PNO
+#define RFC_CONST_WF_PNO 1024
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Products of a single pulse, filled by the feedback stage and consumed by the diagnostics stage. Everything
+ *   the diagnostics stage uses of a pulse is copied here, it never reads the data being written by the feedback
+ *   stage for the next pulses
+ */
+typedef struct {
+    long   pulseCnt;                                        /* pulse counter read from the firmware */
+    long   irqDelayCnt;                                     /* IRQ delay counter of this pulse */
+    long   irqMissingCnt;                                   /* IRQ missing counter after this pulse */
+    double irqTime_ns;                                      /* time when the IRQ returned (monotonic), for the deadline of the diagnostics */
+    long   demodMode;                                       /* demodulation mode latched by the feedback stage for this pulse */
+
+    double fb_pha_deg;                                      /* copy of the feedback results of this pulse */
+    double fb_phaErr_deg;
+    double fb_phaAdj_deg;
+    double fb_amp_MV;
+    double fb_ampErr_MV;
+
+    double sampleFreq_MHz[RFC_CONST_PIPE_CH_NUM];           /* sampling settings of each channel */
+    double sampleDelay_ns[RFC_CONST_PIPE_CH_NUM];
+    long   pointNum[RFC_CONST_PIPE_CH_NUM];
+
+    double avgDataI[RFC_CONST_PIPE_CH_NUM];                 /* window average of the feedback channels, as used by the feedback */
+    double avgDataQ[RFC_CONST_PIPE_CH_NUM];
+    double avgDataAmp[RFC_CONST_PIPE_CH_NUM];
+    double avgDataPha_deg[RFC_CONST_PIPE_CH_NUM];
+
+    long   demodCoefIdCur[RFC_CONST_PIPE_CH_NUM];           /* demodulation coefficient id of the first point of each channel */
+    short  wfRaw[RFC_CONST_PIPE_CH_NUM][RFC_CONST_WF_PNO];  /* raw ADC data of the channels */
+
+    short  fbWfI[RFC_CONST_PIPE_FB_CH_NUM][RFC_CONST_WF_PNO];  /* demodulated waveforms of the feedback channels, only valid in FULL mode */
+    short  fbWfQ[RFC_CONST_PIPE_FB_CH_NUM][RFC_CONST_WF_PNO];
+} RFC_struc_pulseData;
+
+/**
+ * Lock-free ring between the two stages. The head is only written by the producer and the tail
+ *   only by the consumer, so no lock is needed
+ */
+typedef struct {
+    volatile unsigned long head;                            /* number of pulses published by the producer */
+    volatile unsigned long tail;                            /* number of pulses released by the consumer */
+    volatile long dropCnt;                                  /* pulses not handed over because the ring was full */
+    RFC_struc_pulseData slot[RFC_CONST_PIPE_DEPTH];
+} RFC_struc_pipeline;
+
+/*======================================
+ * Routines
+ *======================================*/
+void                 RFC_func_pipeInit(RFC_struc_pipeline *pipe);
+
+RFC_struc_pulseData *RFC_func_pipeGetFreeSlot(RFC_struc_pipeline *pipe);   /* producer: get the slot to be filled, NULL if full */
+void                 RFC_func_pipePublish(RFC_struc_pipeline *pipe);       /* producer: make the filled slot visible to the consumer */
+
+RFC_struc_pulseData *RFC_func_pipeGetFullSlot(RFC_struc_pipeline *pipe);   /* consumer: get the oldest filled slot, NULL if empty */
+void                 RFC_func_pipeRelease(RFC_struc_pipeline *pipe);       /* consumer: give the slot back to the producer */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
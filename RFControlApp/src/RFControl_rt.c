@@ -0,0 +1,171 @@
+/****************************************************
+ * RFControl_rt.c
+ *
+ * Source file for the real-time hardening of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE                                         /* for CPU_SET and pthread_setaffinity_np */
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "EPICSLib_wrapper.h"
+#include "RFControl_rt.h"
+
+/*======================================
+ * Private Data and Routines
+ *======================================*/
+#define RFC_CONST_RT_PAGE_SIZE          4096                /* stride for pre-faulting (touching more often for larger pages is harmless) */
+#define RFC_CONST_RT_CPU_MAX            1024
+
+/**
+ * Parse the CPU list like "2,3" or "2-5,8", call the callback for each CPU
+ * Return:
+ *     number of CPUs   : Successful
+ *    -1                : Syntax error
+ */
+static int RFC_func_rtParseCpus(const char *cpuStr, void (*callback)(int cpu, void *ctx), void *ctx)
+{
+    int   var_cpuNum = 0;
+    long  var_from, var_to, i;
+    const char *var_p = cpuStr;
+    char *var_end;
+
+    if(!cpuStr || !cpuStr[0]) return -1;
+
+    while(*var_p) {
+        var_from = strtol(var_p, &var_end, 10);
+        if(var_end == var_p) return -1;
+
+        var_to = var_from;
+        var_p  = var_end;
+
+        if(*var_p == '-') {
+            var_p ++;
+            var_to = strtol(var_p, &var_end, 10);
+            if(var_end == var_p) return -1;
+            var_p = var_end;
+        }
+
+        if(var_from < 0 || var_to < var_from || var_to >= RFC_CONST_RT_CPU_MAX) return -1;
+
+        for(i = var_from; i <= var_to; i ++) {
+            if(callback) callback((int)i, ctx);
+            var_cpuNum ++;
+        }
+
+        if(*var_p == ',') {
+            var_p ++;
+            if(!*var_p) return -1;                          /* trailing comma */
+        } else if(*var_p) {
+            return -1;
+        }
+    }
+
+    return var_cpuNum;
+}
+
+#ifdef __linux__
+static void RFC_func_rtAddCpu(int cpu, void *ctx)
+{
+    CPU_SET(cpu, (cpu_set_t *)ctx);
+}
+#endif
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Check the syntax of the CPU list
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_rtCheckCpus(const char *cpuStr)
+{
+    if(!cpuStr || strlen(cpuStr) >= RFC_CONST_RT_CPUS_LEN) return -1;
+
+    return RFC_func_rtParseCpus(cpuStr, NULL, NULL) > 0 ? 0 : -1;
+}
+
+/**
+ * Pin the calling thread to the CPU list
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_rtSetCpus(const char *cpuStr)
+{
+#ifdef __linux__
+    int       status;
+    cpu_set_t var_cpus;
+
+    CPU_ZERO(&var_cpus);
+
+    if(RFC_func_rtParseCpus(cpuStr, RFC_func_rtAddCpu, (void *)&var_cpus) <= 0) {
+        EPICSLIB_func_errlogPrintf("RFC_func_rtSetCpus: Illegal CPU list %s\n", cpuStr ? cpuStr : "");
+        return -1;
+    }
+
+    status = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &var_cpus);
+
+    if(status != 0) {
+        EPICSLIB_func_errlogPrintf("RFC_func_rtSetCpus: Failed to set the CPU affinity to %s (%s)\n", cpuStr, strerror(status));
+        return -1;
+    }
+
+    return 0;
+#else
+    EPICSLIB_func_errlogPrintf("RFC_func_rtSetCpus: CPU affinity is not supported on this OS\n");
+    return -1;
+#endif
+}
+
+/**
+ * Lock all current and future pages of the process into the RAM
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed 
+ */
+int RFC_func_rtLockMemory(void)
+{
+#ifdef __linux__
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        EPICSLIB_func_errlogPrintf("RFC_func_rtLockMemory: mlockall failed (%s), check the RLIMIT_MEMLOCK or CAP_IPC_LOCK\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+#else
+    EPICSLIB_func_errlogPrintf("RFC_func_rtLockMemory: memory locking is not supported on this OS\n");
+    return -1;
+#endif
+}
+
+/**
+ * Touch every page of a buffer so that the page faults happen here and not in the real-time loop. The 
+ *   touch is an atomic add of 0, so the buffer content is not changed even if other threads are using it.
+ *   If called by a pinned thread, the pages are also allocated on its local NUMA node (first touch)
+ */
+void RFC_func_rtPrefault(void *addr, size_t len)
+{
+    size_t i;
+    volatile char *var_p = (volatile char *)addr;
+
+    if(!addr || len == 0) return;
+
+    for(i = 0; i < len; i += RFC_CONST_RT_PAGE_SIZE)
+        __sync_fetch_and_add(var_p + i, 0);
+
+    __sync_fetch_and_add(var_p + len - 1, 0);
+}
+
@@ -0,0 +1,35 @@
+/****************************************************
+ * RFControl_rt.h
+ *
+ * Header file for the real-time hardening of the RFControl module: CPU affinity of the threads, memory
+ *   locking and pre-faulting of the large buffers. Only supported on Linux, on other OS the routines
+ *   print a message and return -1
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_RT_H
+#define RF_CONTROL_RT_H
+
+#include <stddef.h>
+
+#define RFC_CONST_RT_CPUS_LEN           64                  /* length of the CPU list string, e.g. "2,3" or "2-5,8" */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Routines
+ *======================================*/
+int  RFC_func_rtCheckCpus(const char *cpuStr);                              /* check the syntax of the CPU list */
+int  RFC_func_rtSetCpus(const char *cpuStr);                                /* pin the calling thread to the CPU list */
+int  RFC_func_rtLockMemory(void);                                           /* lock all current and future pages of the process */
+void RFC_func_rtPrefault(void *addr, size_t len);                           /* touch every page of a buffer */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
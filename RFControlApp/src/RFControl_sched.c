@@ -0,0 +1,144 @@
+/****************************************************
+ * RFControl_sched.c
+ *
+ * Source file for the scheduler of the non-critical diagnostics tasks of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "RFControl_latency.h"
+#include "RFControl_sched.h"
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the scheduler
+ */
+void RFC_func_schedInit(RFC_struc_sched *sched)
+{
+    if(!sched) return;
+
+    memset((void *)sched, 0, sizeof(RFC_struc_sched));
+    sched -> deadline_us = RFC_CONST_SCHED_DEADLINE_US;
+}
+
+/**
+ * Register a task
+ * Input:
+ *     sched            : Scheduler
+ *     name             : Name of the task
+ *     func             : Task routine, called with module, data and the pulse being handled
+ *     priority         : Larger value runs first
+ *     costEst_us       : Initial estimate of the execution time
+ * Return:
+ *     >=0              : Index of the task
+ *    -1                : Failed
+ */
+int RFC_func_schedAddTask(RFC_struc_sched *sched, const char *name, RFC_type_taskFunc func, void *module, void *data, int priority, double costEst_us)
+{
+    RFC_struc_task *task;
+
+    if(!sched || !name || !name[0] || !func || sched -> taskNum >= RFC_CONST_SCHED_TASK_NUM) return -1;
+
+    task = &sched -> task[sched -> taskNum];
+
+    strncpy(task -> name, name, RFC_CONST_SCHED_NAME_LEN - 1);
+    task -> func        = func;
+    task -> module      = module;
+    task -> data        = data;
+    task -> priority    = priority;
+    task -> cost_us     = costEst_us;
+    task -> rateTime_ns = RFC_func_latGetTime_ns();
+
+    return sched -> taskNum ++;
+}
+
+/**
+ * Run the tasks that fit before the deadline of the pulse
+ * Input:
+ *     sched            : Scheduler
+ *     pulseTime_ns     : Time of the IRQ of the pulse (RFC_func_latGetTime_ns)
+ *     pulse            : Pulse data, passed to the tasks
+ */
+void RFC_func_schedRun(RFC_struc_sched *sched, double pulseTime_ns, void *pulse)
+{
+    int    i, j;
+    int    var_order[RFC_CONST_SCHED_TASK_NUM];
+    long   var_prio[RFC_CONST_SCHED_TASK_NUM];
+    int    var_id;
+    long   var_p;
+    double var_deadline_us;
+    double var_elapsed_us;
+    double var_t0_ns;
+    double var_t1_ns;
+    RFC_struc_task *task;
+
+    if(!sched) return;
+
+    /* sort the tasks by the effective priority (insertion sort, only a few tasks) */
+    for(i = 0; i < sched -> taskNum; i ++) {
+        var_id = i;
+        var_p  = sched -> task[i].priority + sched -> task[i].age;
+
+        for(j = i; j > 0 && var_prio[j - 1] < var_p; j --) {
+            var_order[j] = var_order[j - 1];
+            var_prio[j]  = var_prio[j - 1];
+        }
+
+        var_order[j] = var_id;
+        var_prio[j]  = var_p;
+    }
+
+    /* run the tasks */
+    var_deadline_us = sched -> deadline_us;
+    var_t0_ns       = RFC_func_latGetTime_ns();
+    var_elapsed_us  = (var_t0_ns - pulseTime_ns) / 1000.0;
+
+    if(var_elapsed_us >= var_deadline_us) sched -> lateCnt ++;
+
+    for(i = 0; i < sched -> taskNum; i ++) {
+        task = &sched -> task[var_order[i]];
+
+        if(var_elapsed_us + task -> cost_us > var_deadline_us &&
+           !(task -> age >= RFC_CONST_SCHED_MAX_AGE && var_elapsed_us < var_deadline_us)) {
+            task -> skipCnt ++;
+            task -> age ++;
+            continue;
+        }
+
+        task -> func(task -> module, task -> data, pulse);
+
+        var_t1_ns       = RFC_func_latGetTime_ns();
+        task -> cost_us = task -> cost_us * (1.0 - RFC_CONST_SCHED_COST_ALPHA) + (var_t1_ns - var_t0_ns) / 1000.0 * RFC_CONST_SCHED_COST_ALPHA;
+        task -> runCnt ++;
+        task -> age     = 0;
+
+        var_t0_ns       = var_t1_ns;
+        var_elapsed_us  = (var_t1_ns - pulseTime_ns) / 1000.0;
+    }
+}
+
+/**
+ * Calculate the run rate of a task since the last call
+ */
+void RFC_func_schedCalcRate(RFC_struc_task *task)
+{
+    long   var_runCnt;
+    double var_time_ns;
+
+    if(!task) return;
+
+    var_runCnt  = task -> runCnt;
+    var_time_ns = RFC_func_latGetTime_ns();
+
+    if(var_time_ns > task -> rateTime_ns)
+        task -> runRate_Hz = (var_runCnt - task -> runCntOld) * 1e9 / (var_time_ns - task -> rateTime_ns);
+
+    task -> runCntOld   = var_runCnt;
+    task -> rateTime_ns = var_time_ns;
+}
+
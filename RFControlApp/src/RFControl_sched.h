@@ -0,0 +1,70 @@
+/****************************************************
+ * RFControl_sched.h
+ *
+ * Header file for the scheduler of the non-critical diagnostics tasks of the RFControl module. Each task
+ *   is registered with a priority and a cost estimate. Per pulse, the tasks are tried in the order of the
+ *   effective priority (priority plus the number of pulses since the last run, so that the low priority
+ *   tasks are not starved), and a task is only run if its cost fits into the time left before the deadline
+ *   (relative to the IRQ of the pulse). The cost estimate is updated by the measured execution time with
+ *   an exponential moving average
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_SCHED_H
+#define RF_CONTROL_SCHED_H
+
+#define RFC_CONST_SCHED_TASK_NUM        16                  /* maximum number of tasks */
+#define RFC_CONST_SCHED_NAME_LEN        32
+#define RFC_CONST_SCHED_DEADLINE_US     6000                /* default deadline after the IRQ (the pulse period is 8333 us at 120 Hz) */
+#define RFC_CONST_SCHED_COST_ALPHA      0.1                 /* weight of the new measurement in the cost estimate */
+#define RFC_CONST_SCHED_MAX_AGE         120                 /* a task skipped so many pulses is run once if there is any time left, to refresh its cost estimate */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+typedef void (*RFC_type_taskFunc)(void *module, void *data, void *pulse);
+
+typedef struct {
+    char              name[RFC_CONST_SCHED_NAME_LEN];       /* name of the task, used for the PV names */
+    RFC_type_taskFunc func;                                 /* task routine and its arguments */
+    void             *module;
+    void             *data;
+    int               priority;                             /* larger value runs first */
+
+    volatile double   cost_us;                              /* estimated execution time */
+    long              age;                                  /* pulses since the last run */
+
+    volatile long     runCnt;                               /* statistics */
+    volatile long     skipCnt;
+    volatile double   runRate_Hz;                           /* calculated when the PV is read */
+    long              runCntOld;
+    double            rateTime_ns;
+} RFC_struc_task;
+
+typedef struct {
+    RFC_struc_task    task[RFC_CONST_SCHED_TASK_NUM];
+    int               taskNum;
+
+    volatile double   deadline_us;                          /* deadline of the tasks after the IRQ of the pulse */
+    volatile long     lateCnt;                              /* pulses whose deadline has passed before the tasks start */
+} RFC_struc_sched;
+
+/*======================================
+ * Routines
+ *======================================*/
+void RFC_func_schedInit(RFC_struc_sched *sched);
+int  RFC_func_schedAddTask(RFC_struc_sched *sched, const char *name, RFC_type_taskFunc func, void *module, void *data, int priority, double costEst_us);
+void RFC_func_schedRun(RFC_struc_sched *sched, double pulseTime_ns, void *pulse);  /* called per pulse */
+void RFC_func_schedCalcRate(RFC_struc_task *task);                                  /* called when reading the PVs */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,172 @@
+/****************************************************
+ * RFControl_stats.c
+ *
+ * Source file for the running statistics of the per-pulse scalars of the RFControl module
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "RFControl_stats.h"
+
+static const int RFC_statWinBlockNum[RFC_CONST_STAT_WIN_NUM] = {1, 10, 60};  /* blocks of each window */
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Merge the accumulator b into a (parallel form of the Welford method)
+ */
+static void RFC_func_statMerge(RFC_struc_statAcc *a, const RFC_struc_statAcc *b)
+{
+    long   var_cnt;
+    double var_delta;
+
+    if(b -> cnt <= 0) return;
+
+    if(a -> cnt <= 0) {
+        *a = *b;
+        return;
+    }
+
+    var_cnt   = a -> cnt + b -> cnt;
+    var_delta = b -> mean - a -> mean;
+
+    a -> mean += var_delta * b -> cnt / var_cnt;
+    a -> m2   += b -> m2 + var_delta * var_delta * a -> cnt * b -> cnt / var_cnt;
+    a -> cnt   = var_cnt;
+
+    if(b -> min < a -> min) a -> min = b -> min;
+    if(b -> max > a -> max) a -> max = b -> max;
+}
+
+/**
+ * Close the current block of all quantities and refresh the windows
+ */
+static void RFC_func_statCloseBlock(RFC_struc_stats *stats)
+{
+    RFC_struc_statQty *ptr_qty;
+    RFC_struc_statAcc  var_acc;
+    unsigned long var_blockNum;
+    unsigned long b;
+    int i, w;
+
+    for(i = 0; i < stats -> qtyNum; i ++) {
+        ptr_qty = &stats -> qty[i];
+        ptr_qty -> block[stats -> blockCnt % RFC_CONST_STAT_BLOCK_NUM] = ptr_qty -> cur;
+        memset((void *)&ptr_qty -> cur, 0, sizeof(RFC_struc_statAcc));
+    }
+
+    stats -> blockCnt ++;
+
+    for(i = 0; i < stats -> qtyNum; i ++) {
+        ptr_qty = &stats -> qty[i];
+
+        for(w = 0; w < RFC_CONST_STAT_WIN_NUM; w ++) {
+            var_blockNum = (unsigned long)RFC_statWinBlockNum[w];
+            if(var_blockNum > stats -> blockCnt) var_blockNum = stats -> blockCnt;     /* not enough blocks yet after the start */
+
+            memset((void *)&var_acc, 0, sizeof(RFC_struc_statAcc));
+            for(b = 1; b <= var_blockNum; b ++)
+                RFC_func_statMerge(&var_acc, &ptr_qty -> block[(stats -> blockCnt - b) % RFC_CONST_STAT_BLOCK_NUM]);
+
+            ptr_qty -> win[w].mean = var_acc.mean;
+            ptr_qty -> win[w].rms  = var_acc.cnt > 0 ? sqrt(var_acc.m2 / var_acc.cnt) : 0;
+            ptr_qty -> win[w].min  = var_acc.min;
+            ptr_qty -> win[w].max  = var_acc.max;
+        }
+    }
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the statistics
+ */
+void RFC_func_statInit(RFC_struc_stats *stats)
+{
+    if(!stats) return;
+
+    memset((void *)stats, 0, sizeof(RFC_struc_stats));
+}
+
+/**
+ * Register a quantity, should be done before the pulses are recorded
+ * Return:
+ *     id of the quantity   : Successful
+ *    -1                    : Failed
+ */
+int RFC_func_statAdd(RFC_struc_stats *stats, const char *name, volatile double *src)
+{
+    RFC_struc_statQty *ptr_qty;
+
+    if(!stats || !name || !src || stats -> qtyNum >= RFC_CONST_STAT_QTY_NUM) return -1;
+
+    ptr_qty = &stats -> qty[stats -> qtyNum];
+
+    strncpy(ptr_qty -> name, name, RFC_CONST_STAT_NAME_LEN - 1);
+    ptr_qty -> src = src;
+
+    return stats -> qtyNum ++;
+}
+
+/**
+ * Record the quantities of a pulse. Only called by the worker thread, for every pulse
+ * Input:
+ *     pulseTime_ns     : Monotonic time of the pulse, defines the block the pulse belongs to
+ * Return:
+ *     1                : The block is completed and the windows are refreshed
+ *     0                : Otherwise
+ */
+int RFC_func_statRecord(RFC_struc_stats *stats, double pulseTime_ns)
+{
+    RFC_struc_statAcc *ptr_acc;
+    double var_value;
+    double var_delta;
+    int    var_closed = 0;
+    int    i;
+    unsigned long var_blockNum;
+    unsigned long b;
+
+    if(!stats) return 0;
+
+    /* close all blocks whose time is over. After a gap (no pulses) the blocks of the gap are closed empty, so that
+       the windows only cover their own time; more than RFC_CONST_STAT_BLOCK_NUM empty blocks change nothing */
+    if(stats -> blockStart_ns <= 0) {
+        stats -> blockStart_ns = pulseTime_ns;
+    } else if(pulseTime_ns - stats -> blockStart_ns >= RFC_CONST_STAT_BLOCK_NS) {
+        var_blockNum = (unsigned long)((pulseTime_ns - stats -> blockStart_ns) / RFC_CONST_STAT_BLOCK_NS);
+
+        for(b = 0; b < var_blockNum && b < RFC_CONST_STAT_BLOCK_NUM; b ++) 
+            RFC_func_statCloseBlock(stats);
+
+        stats -> blockStart_ns += var_blockNum * RFC_CONST_STAT_BLOCK_NS;
+        var_closed = 1;
+    }
+
+    /* Welford update */
+    for(i = 0; i < stats -> qtyNum; i ++) {
+        ptr_acc   = &stats -> qty[i].cur;
+        var_value = *stats -> qty[i].src;
+
+        if(ptr_acc -> cnt == 0) {
+            ptr_acc -> min = var_value;
+            ptr_acc -> max = var_value;
+        } else {
+            if(var_value < ptr_acc -> min) ptr_acc -> min = var_value;
+            if(var_value > ptr_acc -> max) ptr_acc -> max = var_value;
+        }
+
+        ptr_acc -> cnt ++;
+        var_delta       = var_value - ptr_acc -> mean;
+        ptr_acc -> mean += var_delta / ptr_acc -> cnt;
+        ptr_acc -> m2   += var_delta * (var_value - ptr_acc -> mean);
+    }
+
+    return var_closed;
+}
+
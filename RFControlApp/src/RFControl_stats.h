@@ -0,0 +1,82 @@
+/****************************************************
+ * RFControl_stats.h
+ *
+ * Header file for the running statistics of the per-pulse scalars of the RFControl module. Each
+ *   quantity is accumulated per pulse with the Welford method (count, mean, sum of the squared
+ *   deviations, min and max) into a block of RFC_CONST_STAT_BLOCK_NS. The completed blocks are kept in
+ *   a ring and the sliding windows (last 1, 10 and 60 blocks) are merged from them when a block is
+ *   completed, so the work per pulse is O(1) per quantity and the windows are refreshed once per block
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef RF_CONTROL_STATS_H
+#define RF_CONTROL_STATS_H
+
+#define RFC_CONST_STAT_QTY_NUM          24                  /* maximum number of quantities */
+#define RFC_CONST_STAT_NAME_LEN         32
+#define RFC_CONST_STAT_BLOCK_NS         1e9                 /* time covered by a block */
+#define RFC_CONST_STAT_BLOCK_NUM        60                  /* blocks kept, the longest window */
+
+#define RFC_CONST_STAT_WIN_NUM          3                   /* windows of 1, 10 and 60 blocks */
+#define RFC_CONST_STAT_WIN_1S           0
+#define RFC_CONST_STAT_WIN_10S          1
+#define RFC_CONST_STAT_WIN_60S          2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Accumulator of the Welford method
+ */
+typedef struct {
+    long   cnt;
+    double mean;
+    double m2;                                              /* sum of the squared deviations from the mean */
+    double min;
+    double max;
+} RFC_struc_statAcc;
+
+/**
+ * Published statistics of a window
+ */
+typedef struct {
+    volatile double mean;
+    volatile double rms;                                    /* standard deviation around the mean (jitter) */
+    volatile double min;
+    volatile double max;
+} RFC_struc_statResult;
+
+typedef struct {
+    char                 name[RFC_CONST_STAT_NAME_LEN];     /* name of the quantity, used for the PV names */
+    volatile double     *src;                               /* source of the quantity, read per pulse */
+    RFC_struc_statAcc    cur;                               /* block being accumulated */
+    RFC_struc_statAcc    block[RFC_CONST_STAT_BLOCK_NUM];   /* completed blocks, ring */
+    RFC_struc_statResult win[RFC_CONST_STAT_WIN_NUM];
+} RFC_struc_statQty;
+
+typedef struct {
+    RFC_struc_statQty qty[RFC_CONST_STAT_QTY_NUM];
+    int               qtyNum;
+
+    unsigned long     blockCnt;                             /* number of completed blocks */
+    double            blockStart_ns;                        /* start time of the block being accumulated, 0 before the first pulse */
+} RFC_struc_stats;
+
+/*======================================
+ * Routines
+ *======================================*/
+void RFC_func_statInit(RFC_struc_stats *stats);
+int  RFC_func_statAdd(RFC_struc_stats *stats, const char *name, volatile double *src);     /* register a quantity, return its id */
+int  RFC_func_statRecord(RFC_struc_stats *stats, double pulseTime_ns);                      /* called per pulse, return 1 if the windows are refreshed */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
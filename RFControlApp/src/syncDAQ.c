@@ -16,36 +16,687 @@
 #include "syncDAQ.h"
 
 /*======================================
- * Global data for module management
+ * Private Routines
  *======================================*/
-/* A global list of the data */
-static EPICSLIB_type_linkedList SDAQ_gvar_dataNodeList;
-static EPICSLIB_type_linkedList SDAQ_gvar_wfNodeList;
 
-static int SDAQ_gvar_dataNodeListInitalized  = 0;
-static int SDAQ_gvar_wfNodeListInitalized    = 0;
+/**
+ * Describe the stamp of the pulses as the first channels of a file, the stamp of a pulse is 
+ *   SDAQ_CONST_STAMP_LEN values starting from stamp + pulse * stampStride
+ * Return:
+ *     number of the sources filled (0 if no stamp)
+ */
+static int SDAQ_func_getStampSource(SDAQ_struc_session *session, const uint64_t *stamp, long stampStride, SDAQ_struc_fileSource *src)
+{
+    int i;
+
+    if(!stamp) return 0;
+
+    for(i = 0; i < SDAQ_CONST_STAMP_LEN; i ++) {
+        src[i].name        = session -> stampName[i];
+        src[i].type        = SDAQ_CONST_TYPE_UINT64;
+        src[i].pno         = 1;
+        src[i].scale       = 1.0;
+        src[i].offset      = 0.0;
+        src[i].data        = (const void *)(stamp + i);
+        src[i].pulseStride = stampStride;
+    }
+
+    return SDAQ_CONST_STAMP_LEN;
+}
+
+/**
+ * Describe the data nodes as the channels of a file, the buffer of the node i is data + i * nodeStride 
+ *   (in values) and the pulses of a node are pulseStride values apart. If data is NULL, only the nodes 
+ *   with the bufWrite of a completed capture are described. The stamp channels are put in front if 
+ *   stamp is given
+ * Return:
+ *     sources          : Successful, to be freed by the caller. The number of sources is put in chNum
+ *     NULL             : Failed
+ */
+static SDAQ_struc_fileSource *SDAQ_func_getDataSource(SDAQ_struc_session *session, const double *data, long nodeStride, long pulseStride, 
+                                                      const uint64_t *stamp, long stampStride, int *chNum)
+{
+    SDAQ_struc_dataNode   *ptr_data = NULL;
+    SDAQ_struc_fileSource *ptr_src  = NULL;
+    int i = 0;
+    int n = 0;
+
+    ptr_src = (SDAQ_struc_fileSource *)calloc(session -> dataNodeNum + SDAQ_CONST_STAMP_LEN, sizeof(SDAQ_struc_fileSource));
+    if(!ptr_src) return NULL;
+
+    n = SDAQ_func_getStampSource(session, stamp, stampStride, ptr_src);
+
+    for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList);
+        ptr_data && i < session -> dataNodeNum;
+        ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node), i ++) {
+            if(!data && !ptr_data -> bufWrite) continue;
+
+            ptr_src[n].name        = ptr_data -> name;
+            ptr_src[n].type        = SDAQ_CONST_TYPE_DOUBLE;
+            ptr_src[n].pno         = 1;
+            ptr_src[n].scale       = 1.0;
+            ptr_src[n].offset      = 0.0;
+            ptr_src[n].data        = data ? (const void *)(data + i * nodeStride) : (const void *)ptr_data -> bufWrite;
+            ptr_src[n].pulseStride = pulseStride;
+            n ++;
+    }
+
+    *chNum = n;
+
+    return ptr_src;
+}
+
+/**
+ * Describe the waveform nodes as the channels of a file, similar as SDAQ_func_getDataSource. If data is given,
+ *   the waveforms of the nodes are next to each other in a pulse record of pulseStride points
+ */
+static SDAQ_struc_fileSource *SDAQ_func_getWfSource(SDAQ_struc_session *session, const short *data, long pulseStride, 
+                                                    const uint64_t *stamp, long stampStride, int *chNum)
+{
+    SDAQ_struc_wfNode     *ptr_wf   = NULL;
+    SDAQ_struc_fileSource *ptr_src  = NULL;
+    long var_offset = 0;
+    int  i = 0;
+    int  n = 0;
+
+    ptr_src = (SDAQ_struc_fileSource *)calloc(session -> wfNodeNum + SDAQ_CONST_STAMP_LEN, sizeof(SDAQ_struc_fileSource));
+    if(!ptr_src) return NULL;
+
+    n = SDAQ_func_getStampSource(session, stamp, stampStride, ptr_src);
+
+    for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList);
+        ptr_wf && i < session -> wfNodeNum;
+        ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node), i ++) {
+            if(data || ptr_wf -> bufWrite) {
+                ptr_src[n].name        = ptr_wf -> name;
+                ptr_src[n].type        = SDAQ_CONST_TYPE_SHORT;
+                ptr_src[n].pno         = ptr_wf -> pno;
+                ptr_src[n].scale       = 1.0;
+                ptr_src[n].offset      = 0.0;
+                ptr_src[n].data        = data ? (const void *)(data + var_offset) : (const void *)ptr_wf -> bufWrite;
+                ptr_src[n].pulseStride = data ? pulseStride : ptr_wf -> pno;
+                n ++;
+            }
+
+            var_offset += ptr_wf -> pno;
+    }
+
+    *chNum = n;
+
+    return ptr_src;
+}
+
+/**
+ * Keep the statistics of a compressed file
+ */
+static void SDAQ_func_updateCodecStat(SDAQ_struc_session *session, const SDAQ_struc_fileStat *stat)
+{
+    if(stat -> codecTime_s <= 0 || stat -> fileBytes <= 0) return;          /* not compressed */
+
+    session -> codecRatio      = stat -> rawBytes / stat -> fileBytes;
+    session -> codecSpeed_MBps = stat -> rawBytes / stat -> codecTime_s / 1.0e6;
+}
+
+/**
+ * Write the data buffers of the data job to file
+ */
+static int SDAQ_func_writeData(SDAQ_struc_session *session)
+{
+    SDAQ_struc_writeJob   *job     = &session -> dataJob;
+    SDAQ_struc_fileSource *ptr_src = NULL;
+    SDAQ_struc_fileStat    var_stat;
+    int var_chNum;
+    int status;
+
+    ptr_src = SDAQ_func_getDataSource(session, NULL, 0, 1, session -> dataStampWrite, SDAQ_CONST_STAMP_LEN, &var_chNum);
+    if(!ptr_src) return -1;
+
+    status = SDAQ_func_fileWrite(job -> fileName, session -> fileLayout, session -> codec, ptr_src, var_chNum, 
+                                 0, job -> pulseNum, job -> pulseNum, &job -> percent, &var_stat);
+
+    free(ptr_src);
+
+    if(status == 0) SDAQ_func_updateCodecStat(session, &var_stat);
+
+    return status;
+}
+
+/**
+ * Write the waveform buffers of the waveform job to file, only the real points of each waveform are written
+ */
+static int SDAQ_func_writeWf(SDAQ_struc_session *session)
+{
+    SDAQ_struc_writeJob   *job     = &session -> wfJob;
+    SDAQ_struc_fileSource *ptr_src = NULL;
+    SDAQ_struc_fileStat    var_stat;
+    int var_chNum;
+    int status;
+
+    ptr_src = SDAQ_func_getWfSource(session, NULL, 0, session -> wfStampWrite, SDAQ_CONST_STAMP_LEN, &var_chNum);
+    if(!ptr_src) return -1;
+
+    status = SDAQ_func_fileWrite(job -> fileName, session -> fileLayout, session -> codec, ptr_src, var_chNum, 
+                                 0, job -> pulseNum, job -> pulseNum, &job -> percent, &var_stat);
+
+    free(ptr_src);
+
+    if(status == 0) SDAQ_func_updateCodecStat(session, &var_stat);
+
+    return status;
+}
+
+/**
+ * Move the capture buffers of the selected data nodes to the writer (give them back to the pool if the writer
+ *   is busy or the capture is given up). Called by the thread saving the data, so the buffers are cleared
+ *   later by the writer thread
+ */
+static void SDAQ_func_handOverDataBuf(SDAQ_struc_session *session, int toWriter)
+{
+    SDAQ_struc_dataNode *ptr_data = NULL;
+    int i;
+
+    for(i = 0; i < session -> dataSelNum; i ++) {
+        ptr_data = session -> dataSel[i];
+        if(toWriter) ptr_data -> bufWrite = ptr_data -> buf;
+        else         SDAQ_func_poolFreeLater((void *)ptr_data -> buf, sizeof(double) * session -> dataCap.pulseNum);
+        ptr_data -> buf = NULL;
+    }
+
+    if(toWriter) session -> dataStampWrite = session -> dataStampBuf;
+    else         SDAQ_func_poolFreeLater((void *)session -> dataStampBuf, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> dataCap.pulseNum);
+    session -> dataStampBuf = NULL;
+}
+
+/**
+ * Move the capture buffers of the selected waveform nodes to the writer, similar as SDAQ_func_handOverDataBuf
+ */
+static void SDAQ_func_handOverWfBuf(SDAQ_struc_session *session, int toWriter)
+{
+    SDAQ_struc_wfNode *ptr_wf = NULL;
+    int i;
+
+    for(i = 0; i < session -> wfSelNum; i ++) {
+        ptr_wf = session -> wfSel[i];
+        if(toWriter) ptr_wf -> bufWrite = ptr_wf -> buf;
+        else         SDAQ_func_poolFreeLater((void *)ptr_wf -> buf, sizeof(short) * ptr_wf -> pno * session -> wfCap.pulseNum);
+        ptr_wf -> buf = NULL;
+    }
+
+    if(toWriter) session -> wfStampWrite = session -> wfStampBuf;
+    else         SDAQ_func_poolFreeLater((void *)session -> wfStampBuf, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> wfCap.pulseNum);
+    session -> wfStampBuf = NULL;
+}
+
+/**
+ * Start a data capture: latch the settings, select the nodes and get their capture buffers from the pool
+ * Return:
+ *     0                : Successful
+ *    -1                : No node selected or no buffer, the buffers got are given back
+ */
+static int SDAQ_func_startDataCapture(SDAQ_struc_session *session)
+{
+    SDAQ_struc_dataNode *ptr_data = NULL;
+    int i = 0;
+
+    SDAQ_func_handOverDataBuf(session, 0);                  /* buffers left by a capture not finished */
+
+    session -> dataCap    = session -> dataCapReq;
+    session -> dataSelNum = 0;
+
+    session -> dataStampBuf = (uint64_t *)SDAQ_func_poolAlloc(sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> dataCap.pulseNum);
+    if(!session -> dataStampBuf) return -1;
+
+    for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList);
+        ptr_data && i < SDAQ_CONST_NODE_MAX;
+        ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node), i ++) {
+            if(!((session -> dataCap.chMask >> i) & 1)) continue;
+
+            ptr_data -> buf = (double *)SDAQ_func_poolAlloc(sizeof(double) * session -> dataCap.pulseNum);
+            if(!ptr_data -> buf) break;
+
+            session -> dataSel[session -> dataSelNum ++] = ptr_data;
+    }
+
+    if(ptr_data && i < SDAQ_CONST_NODE_MAX) {               /* stopped by the failure of the allocation */
+        SDAQ_func_handOverDataBuf(session, 0);
+        return -1;
+    }
+
+    return (session -> dataSelNum > 0) ? 0 : -1;
+}
+
+/**
+ * Start a waveform capture, similar as SDAQ_func_startDataCapture
+ */
+static int SDAQ_func_startWfCapture(SDAQ_struc_session *session)
+{
+    SDAQ_struc_wfNode *ptr_wf = NULL;
+    int i = 0;
+
+    SDAQ_func_handOverWfBuf(session, 0);
+
+    session -> wfCap    = session -> wfCapReq;
+    session -> wfSelNum = 0;
+
+    session -> wfStampBuf = (uint64_t *)SDAQ_func_poolAlloc(sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> wfCap.pulseNum);
+    if(!session -> wfStampBuf) return -1;
+
+    for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList);
+        ptr_wf && i < SDAQ_CONST_NODE_MAX;
+        ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node), i ++) {
+            if(!((session -> wfCap.chMask >> i) & 1)) continue;
+
+            ptr_wf -> buf = (short *)SDAQ_func_poolAlloc(sizeof(short) * ptr_wf -> pno * session -> wfCap.pulseNum);
+            if(!ptr_wf -> buf) break;
+
+            session -> wfSel[session -> wfSelNum ++] = ptr_wf;
+    }
+
+    if(ptr_wf && i < SDAQ_CONST_NODE_MAX) {
+        SDAQ_func_handOverWfBuf(session, 0);
+        return -1;
+    }
+
+    return (session -> wfSelNum > 0) ? 0 : -1;
+}
+
+/**
+ * Close the current file of the streaming, the pulse number in the header is updated
+ */
+static void SDAQ_func_streamCloseFile(SDAQ_struc_stream *stream)
+{
+    if(!stream -> file) return;
+
+    SDAQ_func_fileCloseStream(stream -> file, (unsigned long)(stream -> fileBytes / (sizeof(double) * stream -> recordLen)));
+    stream -> file = NULL;
+}
+
+/**
+ * Open the next file of the streaming (pulse-major, one record per pulse)
+ */
+static int SDAQ_func_streamOpenFile(SDAQ_struc_session *session)
+{
+    SDAQ_struc_stream *stream = &session -> stream;
+    char var_fileName[SDAQ_CONST_FILE_NAME_LEN + 16];
+    SDAQ_struc_fileSource *ptr_src = NULL;
+    int var_chNum;
+
+    SDAQ_func_streamCloseFile(stream);
+
+    sprintf(var_fileName, "%s_%04ld", stream -> baseName, stream -> fileCnt);
+
+    ptr_src = SDAQ_func_getDataSource(session, stream -> ring + SDAQ_CONST_STAMP_LEN, 1, stream -> recordLen, 
+                                      (const uint64_t *)stream -> ring, stream -> recordLen, &var_chNum);
+    if(ptr_src) stream -> file = SDAQ_func_fileOpenStream(var_fileName, ptr_src, var_chNum);
+    free(ptr_src);
+
+    stream -> fileBytes = 0;
+    stream -> fileTime  = time(NULL);
+
+    if(!stream -> file) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_streamOpenFile: Failed to open the file %s\n", var_fileName);
+        return -1;
+    }
+
+    stream -> fileCnt ++;
+
+    return 0;
+}
+
+/**
+ * Finish the streaming, close the file and give the ring back to the pool
+ */
+static void SDAQ_func_streamClose(SDAQ_struc_stream *stream, int state)
+{
+    SDAQ_func_streamCloseFile(stream);
+
+    SDAQ_func_poolFree((void *)stream -> ring, sizeof(double) * SDAQ_CONST_STREAM_DEPTH * stream -> recordLen);
+    stream -> ring = NULL;
+
+    __sync_synchronize();
+    stream -> state = state;
+}
+
+/**
+ * Write the records in the ring to file, called by the writer thread periodically
+ */
+static void SDAQ_func_streamDrain(SDAQ_struc_session *session)
+{
+    SDAQ_struc_stream *stream = &session -> stream;
+    int    var_state = stream -> state;
+    size_t var_recordBytes;
+    double *ptr_record;
+
+    if(var_state != SDAQ_CONST_STREAM_RUNNING && var_state != SDAQ_CONST_STREAM_STOPPING) return;
+
+    /* the producer must not be in the ring when it is given back */
+    if(var_state == SDAQ_CONST_STREAM_STOPPING && stream -> inPush) return;
+
+    var_recordBytes = sizeof(double) * stream -> recordLen;
+
+    /* rotation by time */
+    if(!stream -> file || (stream -> rotatePeriod_s > 0 && difftime(time(NULL), stream -> fileTime) >= stream -> rotatePeriod_s)) {
+        if(SDAQ_func_streamOpenFile(session) != 0) {
+            SDAQ_func_streamClose(stream, SDAQ_CONST_STREAM_FAILED);
+            return;
+        }
+    }
+
+    __sync_synchronize();                                   /* the records must be read after the head */
+
+    while(stream -> tail != stream -> head) {
+        ptr_record = stream -> ring + (stream -> tail & (SDAQ_CONST_STREAM_DEPTH - 1)) * stream -> recordLen;
+
+        if(fwrite(ptr_record, 1, var_recordBytes, stream -> file) != var_recordBytes) {
+            EPICSLIB_func_errlogPrintf("SDAQ_func_streamDrain: Failed to write the file\n");
+            SDAQ_func_streamClose(stream, SDAQ_CONST_STREAM_FAILED);
+            return;
+        }
+
+        __sync_synchronize();                               /* the record must be read before the slot is released */
+        stream -> tail ++;
+        stream -> fileBytes += var_recordBytes;
+
+        /* rotation by size */
+        if(stream -> rotateSize_MB > 0 && stream -> fileBytes >= stream -> rotateSize_MB * 1048576.0) {
+            if(SDAQ_func_streamOpenFile(session) != 0) {
+                SDAQ_func_streamClose(stream, SDAQ_CONST_STREAM_FAILED);
+                return;
+            }
+        }
+    }
+
+    /* records first, then the pulse number in the header, so that a reader of the open file never gets a
+       pulse number larger than the records in the file */
+    fflush(stream -> file);
+    SDAQ_func_fileUpdateStream(stream -> file, (unsigned long)(stream -> fileBytes / var_recordBytes));
+    fflush(stream -> file);
+
+    if(var_state == SDAQ_CONST_STREAM_STOPPING) SDAQ_func_streamClose(stream, SDAQ_CONST_STREAM_IDLE);
+}
+
+/**
+ * Give the post-mortem buffers back to the pool, they are cleared later by the writer thread (this may be
+ *   called by the thread saving the data)
+ */
+static void SDAQ_func_pmRelease(SDAQ_struc_postMortem *pm)
+{
+    SDAQ_func_poolFreeLater((void *)pm -> dataRing, sizeof(double) * pm -> pulseNum * pm -> dataLen);
+    SDAQ_func_poolFreeLater((void *)pm -> wfRing,   sizeof(short)  * pm -> pulseNum * pm -> wfLen);
+
+    pm -> dataRing       = NULL;
+    pm -> wfRing         = NULL;
+    pm -> disableRequest = 0;
+
+    __sync_synchronize();
+    pm -> state          = SDAQ_CONST_PM_IDLE;
+}
+
+/**
+ * Write the frozen post-mortem buffer to file and re-arm it, called by the writer thread
+ */
+static void SDAQ_func_pmDump(SDAQ_struc_session *session)
+{
+    SDAQ_struc_postMortem *pm = &session -> pm;
+    char  var_fileName[SDAQ_CONST_FILE_NAME_LEN + 16];
+    unsigned long var_pulseNum;
+    unsigned long var_first;
+    SDAQ_struc_fileSource *ptr_dataSrc = NULL;
+    SDAQ_struc_fileSource *ptr_wfSrc   = NULL;
+    SDAQ_struc_fileSource *ptr_src     = NULL;
+    int var_dataChNum = 0;
+    int var_wfChNum   = 0;
+    int var_chNum;
+
+    if(pm -> state != SDAQ_CONST_PM_DUMPING) return;
+
+    /* the buffer may be not full if triggered soon after armed */
+    var_pulseNum = (pm -> pulseCnt < (unsigned long)pm -> pulseNum) ? pm -> pulseCnt : (unsigned long)pm -> pulseNum;
+    var_first    = (pm -> pulseCnt - var_pulseNum) % pm -> pulseNum;
+
+    sprintf(var_fileName, "%s_%04ld", pm -> baseName, pm -> dumpCnt);
+
+    /* stamp, all data nodes and waveform nodes in one file */
+    var_chNum   = SDAQ_CONST_STAMP_LEN + session -> dataNodeNum + session -> wfNodeNum;
+    ptr_dataSrc = SDAQ_func_getDataSource(session, pm -> dataRing + SDAQ_CONST_STAMP_LEN, 1, pm -> dataLen, 
+                                          (const uint64_t *)pm -> dataRing, pm -> dataLen, &var_dataChNum);
+    ptr_wfSrc   = SDAQ_func_getWfSource(session, pm -> wfRing, pm -> wfLen, NULL, 0, &var_wfChNum);
+    ptr_src     = (SDAQ_struc_fileSource *)calloc(var_chNum, sizeof(SDAQ_struc_fileSource));
+
+    if(ptr_dataSrc && ptr_wfSrc && ptr_src) {
+        var_chNum = var_dataChNum + var_wfChNum;
+
+        memcpy((void *)ptr_src, (void *)ptr_dataSrc, sizeof(SDAQ_struc_fileSource) * var_dataChNum);
+        memcpy((void *)(ptr_src + var_dataChNum), (void *)ptr_wfSrc, sizeof(SDAQ_struc_fileSource) * var_wfChNum);
+
+        if(SDAQ_func_fileWrite(var_fileName, session -> fileLayout, session -> codec, ptr_src, var_chNum, var_first, var_pulseNum, pm -> pulseNum, NULL, NULL) == 0)
+            pm -> dumpCnt ++;
+    }
+
+    free(ptr_dataSrc);
+    free(ptr_wfSrc);
+    free(ptr_src);
+
+    /* re-arm, or give back the buffers if disabled during the dump */
+    if(pm -> disableRequest) {
+        SDAQ_func_pmRelease(pm);
+    } else {
+        pm -> pulseCnt = 0;
+        __sync_synchronize();
+        pm -> state    = SDAQ_CONST_PM_ARMED;
+    }
+}
+
+/**
+ * Background writer thread of a session, writes the completed captures to file and gives the buffers back to the pool
+ */
+static void SDAQ_func_writerThread(void *argIn)
+{
+    SDAQ_struc_session  *session  = (SDAQ_struc_session *)argIn;
+    SDAQ_struc_dataNode *ptr_data = NULL;
+    SDAQ_struc_wfNode   *ptr_wf   = NULL;
+    int var_state;
+
+    while(1) {
+        epicsEventWaitWithTimeout(session -> writerEvent, SDAQ_CONST_STREAM_DRAIN_PERIOD);
+
+        /* clear the buffers given back by the real-time threads */
+        SDAQ_func_poolCollect();
+
+        if(session -> dataJob.state == SDAQ_CONST_WRITER_BUSY) {
+            if(SDAQ_func_writeData(session) == 0) {
+                var_state = SDAQ_CONST_WRITER_DONE;
+            } else {
+                EPICSLIB_func_errlogPrintf("SDAQ_func_writerThread: Failed to write the file %s\n", session -> dataJob.fileName);
+                var_state = SDAQ_CONST_WRITER_FAILED;
+            }
+
+            /* give the buffers back before releasing the job, the next job will reuse the bufWrite */
+            for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList);
+                ptr_data;
+                ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node)) {
+                    if(!ptr_data -> bufWrite) continue;                                 /* not selected by the capture */
+                    SDAQ_func_poolFree((void *)ptr_data -> bufWrite, sizeof(double) * session -> dataJob.pulseNum);
+                    ptr_data -> bufWrite = NULL;
+            }
+
+            SDAQ_func_poolFree((void *)session -> dataStampWrite, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> dataJob.pulseNum);
+            session -> dataStampWrite = NULL;
+
+            __sync_synchronize();
+            session -> dataJob.state = var_state;
+        }
+
+        if(session -> wfJob.state == SDAQ_CONST_WRITER_BUSY) {
+            if(SDAQ_func_writeWf(session) == 0) {
+                var_state = SDAQ_CONST_WRITER_DONE;
+            } else {
+                EPICSLIB_func_errlogPrintf("SDAQ_func_writerThread: Failed to write the file %s\n", session -> wfJob.fileName);
+                var_state = SDAQ_CONST_WRITER_FAILED;
+            }
+
+            for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList);
+                ptr_wf;
+                ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node)) {
+                    if(!ptr_wf -> bufWrite) continue;
+                    SDAQ_func_poolFree((void *)ptr_wf -> bufWrite, sizeof(short) * ptr_wf -> pno * session -> wfJob.pulseNum);
+                    ptr_wf -> bufWrite = NULL;
+            }
+
+            SDAQ_func_poolFree((void *)session -> wfStampWrite, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * session -> wfJob.pulseNum);
+            session -> wfStampWrite = NULL;
+
+            __sync_synchronize();
+            session -> wfJob.state = var_state;
+        }
+
+        SDAQ_func_streamDrain(session);
+        SDAQ_func_pmDump(session);
+    }
+}
+
+/**
+ * Create the writer thread of the session, called when creating the nodes (not in the real-time path)
+ */
+static int SDAQ_func_initWriter(SDAQ_struc_session *session)
+{
+    char var_threadName[SDAQ_CONST_CH_NAME_LEN + 8];
+
+    if(session -> writerThread) return 0;
+
+    if(SDAQ_func_poolInit() != 0) return -1;
+
+    session -> writerEvent = epicsEventCreate(epicsEventEmpty);
+    if(!session -> writerEvent) return -1;
+
+    sprintf(var_threadName, "%s_SDAQ", session -> name);
+
+    session -> writerThread = EPICSLIB_func_threadCreate(var_threadName, SDAQ_CONST_WRITER_PRIORITY, SDAQ_func_writerThread, (void *)session);
+    if(!session -> writerThread) return -1;
+
+    return 0;
+}
+
+/**
+ * Reserve the blocks of a capture with the settings of the user in the pool, the reservation of the previous
+ *   settings is dropped. The sizes are the same as the allocations in SDAQ_func_startDataCapture and 
+ *   SDAQ_func_startWfCapture
+ */
+static void SDAQ_func_reserveCapture(SDAQ_struc_session *session, SDAQ_struc_reserve *res, const SDAQ_struc_capture *cap, int isWf)
+{
+    SDAQ_struc_dataNode *ptr_data = NULL;
+    SDAQ_struc_wfNode   *ptr_wf   = NULL;
+    int i;
+
+    for(i = 0; i < res -> blockNum; i ++)
+        SDAQ_func_poolReserve(res -> blockSize[i], -SDAQ_CONST_CAPTURE_RESERVE_NUM);
+
+    res -> blockNum = 0;
+    res -> blockSize[res -> blockNum ++] = sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN * cap -> pulseNum;
+
+    if(isWf) {
+        for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList), i = 0;
+            ptr_wf && i < SDAQ_CONST_NODE_MAX;
+            ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node), i ++) {
+                if((cap -> chMask >> i) & 1) res -> blockSize[res -> blockNum ++] = sizeof(short) * ptr_wf -> pno * cap -> pulseNum;
+        }
+    } else {
+        for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList), i = 0;
+            ptr_data && i < SDAQ_CONST_NODE_MAX;
+            ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node), i ++) {
+                if((cap -> chMask >> i) & 1) res -> blockSize[res -> blockNum ++] = sizeof(double) * cap -> pulseNum;
+        }
+    }
+
+    for(i = 0; i < res -> blockNum; i ++) {
+        if(SDAQ_func_poolReserve(res -> blockSize[i], SDAQ_CONST_CAPTURE_RESERVE_NUM) != 0) {
+            EPICSLIB_func_errlogPrintf("SDAQ_func_reserveCapture: Failed to reserve %lu bytes in the pool\n", (unsigned long)res -> blockSize[i]);
+        }
+    }
+}
+
+/**
+ * Hand the completed capture to the writer, the buffers should be moved to bufWrite before
+ */
+static void SDAQ_func_submitJob(SDAQ_struc_session *session, SDAQ_struc_writeJob *job, char *nameStr)
+{
+    strncpy(job -> fileName, nameStr, SDAQ_CONST_FILE_NAME_LEN - 1);
+    job -> fileName[SDAQ_CONST_FILE_NAME_LEN - 1] = 0;
+    job -> percent = 0;
+
+    __sync_synchronize();                                   /* the job content must be visible before the state */
+    job -> state   = SDAQ_CONST_WRITER_BUSY;
+
+    epicsEventSignal(session -> writerEvent);
+}
 
 /*======================================
  * Public Routines
  *======================================*/
 /**
- * Create a data node
+ * Init a session, the writer thread is created when the first node is added
+ * Input:
+ *     session          : Session to be initialized, usually owned by the module instance
+ *     name             : Name of the session (module name), used for the writer thread
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
  */
-int SDAQ_func_createDataNode(double *dataPtr)
+int SDAQ_func_sessionInit(SDAQ_struc_session *session, const char *name)
+{
+    if(!session || !name) return -1;
+
+    memset((void *)session, 0, sizeof(SDAQ_struc_session));
+
+    strncpy(session -> name, name, SDAQ_CONST_CH_NAME_LEN - 1);
+
+    EPICSLIB_func_LinkedListInit(session -> dataNodeList);
+    EPICSLIB_func_LinkedListInit(session -> wfNodeList);
+
+    session -> resMutex   = epicsMutexCreate();
+    if(!session -> resMutex) return -1;
+
+    session -> fileLayout = SDAQ_CONST_LAYOUT_CHANNEL_MAJOR;
+    session -> codec      = SDAQ_CONST_CODEC_NONE;
+
+    /* all nodes with the full buffer length by default */
+    session -> dataCapReq.chMask   = ~0ULL;
+    session -> dataCapReq.pulseNum = SDAQ_CONST_BUF_SIZE;
+    session -> wfCapReq.chMask     = ~0ULL;
+    session -> wfCapReq.pulseNum   = SDAQ_CONST_WF_NUM_SUPPORTED;
+    session -> dataCap             = session -> dataCapReq;
+    session -> wfCap               = session -> wfCapReq;
+
+    /* names of the stamp channels, prefixed like the nodes so that the files of the stations can be merged */
+    snprintf(session -> stampName[0], SDAQ_CONST_CH_NAME_LEN, "%s:PULSE_CNT", session -> name);
+    snprintf(session -> stampName[1], SDAQ_CONST_CH_NAME_LEN, "%s:TIME_NS",   session -> name);
+
+    return 0;
+}
+
+/**
+ * Create a data node in the session. Only the data source is registered here, the capture buffer is got 
+ *   from the pool when a capture starts
+ */
+int SDAQ_func_createDataNode(SDAQ_struc_session *session, double *dataPtr, const char *name)
 {
     SDAQ_struc_dataNode *ptr_data = NULL;
 
     /* check the input */
-    if(!dataPtr) {
-        EPICSLIB_func_errlogPrintf("SDAQ_func_createDataNode: Illegal data address\n");
+    if(!session || !dataPtr) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createDataNode: Illegal session or data address\n");
         return -1;
     }
 
-    /* init the list */
-    if(!SDAQ_gvar_dataNodeListInitalized) {
-        EPICSLIB_func_LinkedListInit(SDAQ_gvar_dataNodeList);
-        SDAQ_gvar_dataNodeListInitalized = 1;
-    }    
+    if(session -> dataNodeNum >= SDAQ_CONST_NODE_MAX) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createDataNode: Too many data nodes in the session %s\n", session -> name);
+        return -1;
+    }
+
+    if(SDAQ_func_initWriter(session) != 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createDataNode: Failed to create the writer thread\n");
+        return -1;
+    }
 
     /* create a data node */
     ptr_data = (SDAQ_struc_dataNode *)calloc(1, sizeof(SDAQ_struc_dataNode));
@@ -57,32 +708,38 @@ int SDAQ_func_createDataNode(double *dataPtr)
 
     /* remember the data source */
     ptr_data -> dataPtr = dataPtr;
-    memset((void *)ptr_data -> buf, 0, sizeof(double) * SDAQ_CONST_BUF_SIZE);
+    if(name) strncpy(ptr_data -> name, name, SDAQ_CONST_CH_NAME_LEN - 1);
 
     /* add to the list */
-    EPICSLIB_func_LinkedListInsert(SDAQ_gvar_dataNodeList, ptr_data -> node);
+    EPICSLIB_func_LinkedListInsert(session -> dataNodeList, ptr_data -> node);
+    session -> dataNodeNum ++;
 
     return 0;
 }
 
 /**
- * Create a waveform node
+ * Create a waveform node in the session. Only the data source is registered here, the capture buffer is got 
+ *   from the pool when a capture starts
  */
-int SDAQ_func_createWfNode(short *dataPtr, int pno)
+int SDAQ_func_createWfNode(SDAQ_struc_session *session, short *dataPtr, int pno, const char *name)
 {
     SDAQ_struc_wfNode *ptr_wf = NULL;
 
     /* check the input */
-    if(!dataPtr || pno <= 0) {
-        EPICSLIB_func_errlogPrintf("SDAQ_func_createWfNode: Illegual waveform buffer or point number\n");
+    if(!session || !dataPtr || pno <= 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createWfNode: Illegual session, waveform buffer or point number\n");
         return -1;
     }
 
-    /* init the list */
-    if(!SDAQ_gvar_wfNodeListInitalized) {
-        EPICSLIB_func_LinkedListInit(SDAQ_gvar_wfNodeList);
-        SDAQ_gvar_wfNodeListInitalized = 1;
-    }    
+    if(session -> wfNodeNum >= SDAQ_CONST_NODE_MAX) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createWfNode: Too many waveform nodes in the session %s\n", session -> name);
+        return -1;
+    }
+
+    if(SDAQ_func_initWriter(session) != 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_createWfNode: Failed to create the writer thread\n");
+        return -1;
+    }
 
     /* create a data node */
     ptr_wf = (SDAQ_struc_wfNode *)calloc(1, sizeof(SDAQ_struc_wfNode));
@@ -95,98 +752,601 @@ int SDAQ_func_createWfNode(short *dataPtr, int pno)
     /* remeber the data source */
     ptr_wf -> dataPtr = dataPtr;
     ptr_wf -> pno     = MATHLIB_min(pno, SDAQ_CONST_WF_PNO_SUPPORTED);
-    memset((void *)ptr_wf -> buf, 0, sizeof(short) * SDAQ_CONST_WF_PNO_SUPPORTED * SDAQ_CONST_WF_NUM_SUPPORTED);    
+    if(name) strncpy(ptr_wf -> name, name, SDAQ_CONST_CH_NAME_LEN - 1);
 
     /* add to the list */
-    EPICSLIB_func_LinkedListInsert(SDAQ_gvar_wfNodeList, ptr_wf -> node);
+    EPICSLIB_func_LinkedListInsert(session -> wfNodeList, ptr_wf -> node);
+    session -> wfNodeNum ++;
 
     return 0;
 }
 
 /**
- * Save data
+ * Reserve the buffers of the data and waveform captures with the settings of the user in the pool, for the 
+ *   running capture and the one being written. Called when the settings change and when the nodes are complete
+ *   (see SDAQ_func_prefault), not by the real-time threads
  */
-int SDAQ_func_saveData(int dataId, char *nameStr)
+int SDAQ_func_reserve(SDAQ_struc_session *session)
 {
-    FILE *outFile                   = NULL;
-    SDAQ_struc_dataNode *ptr_data   = NULL;
+    if(!session || !session -> resMutex) return -1;
+
+    if(SDAQ_func_poolInit() != 0) return -1;
+
+    epicsMutexLock(session -> resMutex);
+    SDAQ_func_reserveCapture(session, &session -> dataRes, &session -> dataCapReq, 0);
+    SDAQ_func_reserveCapture(session, &session -> wfRes,   &session -> wfCapReq,   1);
+    epicsMutexUnlock(session -> resMutex);
+
+    return 0;
+}
+
+/**
+ * Reserve the capture buffers of the session in the pool and touch every page of the blocks in the pool, so 
+ *   that the page faults happen before the real-time acquisition starts and not during the capture. Should be
+ *   called by the thread who saves the data after it is pinned to its CPUs and all nodes are created, so that 
+ *   the pages are allocated on the local NUMA node (first touch)
+ */
+int SDAQ_func_prefault(SDAQ_struc_session *session)
+{
+    int status = SDAQ_func_reserve(session);
+
+    SDAQ_func_poolPrefault();
+
+    return status;
+}
+
+/**
+ * Select the layout of the capture and post-mortem files of the session, applied to the next file
+ */
+void SDAQ_func_setFileLayout(SDAQ_struc_session *session, int layout)
+{
+    if(!session) return;
+
+    if(layout == SDAQ_CONST_LAYOUT_CHANNEL_MAJOR || layout == SDAQ_CONST_LAYOUT_PULSE_MAJOR)
+        session -> fileLayout = layout;
+}
 
-    /* check the input (effective dataId should be in the range of [0, SDAQ_CONST_BUF_SIZE - 1] */
-    if(dataId < 0 || dataId >= SDAQ_CONST_BUF_SIZE || !nameStr || !nameStr[0]) return -1;
+/**
+ * Select the compression of the capture and post-mortem files of the session (channel-major layout only), 
+ *   applied to the next file. The compression is only enabled if the codec passes its self test on this host
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed, the codec is not changed
+ */
+int SDAQ_func_setCodec(SDAQ_struc_session *session, int codec)
+{
+    if(!session) return -1;
+
+    if(codec != SDAQ_CONST_CODEC_NONE && codec != SDAQ_CONST_CODEC_SHUFFLE_LZ) return -1;
 
-    /* save all data in the list */
-    for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(SDAQ_gvar_dataNodeList);
-        ptr_data;
-        ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node)) {  
-                ptr_data -> buf[dataId] = *(ptr_data -> dataPtr);                               /* every node in the list will have valid data address */ 
+    if(codec == SDAQ_CONST_CODEC_SHUFFLE_LZ && SDAQ_func_codecSelfTest() != 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_setCodec: Self test of the codec failed, the files are not compressed\n");
+        return -1;
     }
 
-    /* save to file */
-    if(dataId == SDAQ_CONST_BUF_SIZE - 1) {
+    session -> codec = codec;
 
-        outFile = fopen(nameStr, "w");
+    return 0;
+}
 
-        if(outFile) {
+/**
+ * Get the compression ratio and the speed of the compression (MB of raw data per second) of the last compressed file
+ */
+int SDAQ_func_getCodecStat(SDAQ_struc_session *session, double *ratio, double *speed_MBps)
+{
+    if(!session || !ratio || !speed_MBps) return -1;
 
-            for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(SDAQ_gvar_dataNodeList);
-                ptr_data;
-                ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node)) {        
-                    fwrite(ptr_data -> buf, sizeof(double), SDAQ_CONST_BUF_SIZE, outFile);
-            }       
+    *ratio      = session -> codecRatio;
+    *speed_MBps = session -> codecSpeed_MBps;
 
-            fflush(outFile);
-            fclose(outFile);
+    return 0;
+}
 
+/**
+ * Set the channels and the length of the data captures, taken when the next capture starts. The buffers of
+ *   the captures are reserved in the pool here, so this should not be called by the real-time threads
+ * Input:
+ *     chMask           : Bit i selects the i-th data node in the order of creation
+ *     pulseNum         : Pulses of the capture, 1 to SDAQ_CONST_BUF_SIZE
+ * Return:
+ *     0                : Successful
+ *    -1                : Illegal input
+ */
+int SDAQ_func_setDataCapture(SDAQ_struc_session *session, uint64_t chMask, int pulseNum)
+{
+    if(!session || pulseNum < 1 || pulseNum > SDAQ_CONST_BUF_SIZE) return -1;
+
+    session -> dataCapReq.chMask   = chMask;
+    session -> dataCapReq.pulseNum = pulseNum;
+
+    SDAQ_func_reserve(session);
+
+    return 0;
+}
+
+/**
+ * Set the channels and the length of the waveform captures, similar as SDAQ_func_setDataCapture. The 
+ *   pulseNum should be 1 to SDAQ_CONST_WF_NUM_SUPPORTED
+ */
+int SDAQ_func_setWfCapture(SDAQ_struc_session *session, uint64_t chMask, int pulseNum)
+{
+    if(!session || pulseNum < 1 || pulseNum > SDAQ_CONST_WF_NUM_SUPPORTED) return -1;
+
+    session -> wfCapReq.chMask   = chMask;
+    session -> wfCapReq.pulseNum = pulseNum;
+
+    SDAQ_func_reserve(session);
+
+    return 0;
+}
+
+/**
+ * Get the pulses of the running data capture (latched when the dataId 0 is saved), the caller should stop 
+ *   the capture after saving this number of pulses
+ */
+int SDAQ_func_getDataCaptureLen(SDAQ_struc_session *session)
+{
+    return session ? session -> dataCap.pulseNum : 0;
+}
+
+/**
+ * Get the pulses of the running waveform capture
+ */
+int SDAQ_func_getWfCaptureLen(SDAQ_struc_session *session)
+{
+    return session ? session -> wfCap.pulseNum : 0;
+}
+
+/**
+ * Set the stamp of the current pulse. It is recorded together with the data of this pulse by the captures, 
+ *   the streaming and the post-mortem buffer, so that the missing pulses can be found and the files of different 
+ *   stations can be aligned. Should be called per pulse by the thread saving the data, before the saving
+ * Input:
+ *     pulseCnt         : Pulse counter of the firmware
+ *     time_ns          : Monotonic time of the host in ns when the pulse is received
+ */
+void SDAQ_func_setPulseStamp(SDAQ_struc_session *session, uint64_t pulseCnt, uint64_t time_ns)
+{
+    if(!session) return;
+
+    session -> stamp[0] = pulseCnt;
+    session -> stamp[1] = time_ns;
+}
+
+/**
+ * Save data. The capture settings are latched and the buffers of the selected nodes are got from the pool 
+ *   when dataId is 0. When the buffer is full (see SDAQ_func_getDataCaptureLen), the buffers are handed to 
+ *   the writer thread, who gives them back to the pool after writing the file
+ * Return:
+ *     0                : Successful
+ *    -1                : Illegal input, no buffer, or the capture is dropped because the writer is still busy
+ */
+int SDAQ_func_saveData(SDAQ_struc_session *session, int dataId, char *nameStr)
+{
+    SDAQ_struc_dataNode *ptr_data   = NULL;
+    int i;
+
+    /* check the input (effective dataId should be in the range of [0, pulses of the capture - 1] */
+    if(dataId < 0 || dataId >= SDAQ_CONST_BUF_SIZE || !nameStr || !nameStr[0] || !session || session -> dataNodeNum <= 0) return -1;
+
+    /* select the nodes and get the buffers when the capture starts */
+    if(dataId == 0 && SDAQ_func_startDataCapture(session) != 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_saveData: Failed to start the capture (no channel selected or no buffer)\n");
+        return -1;
+    }
+
+    if(dataId >= session -> dataCap.pulseNum) return -1;
+
+    /* save the selected nodes only */
+    for(i = 0; i < session -> dataSelNum; i ++) {
+        ptr_data = session -> dataSel[i];
+        if(!ptr_data -> buf) return -1;                                                         /* the capture did not get the buffers */
+        ptr_data -> buf[dataId] = *(ptr_data -> dataPtr);                                       /* every node in the list will have valid data address */ 
+    }
+
+    memcpy((void *)(session -> dataStampBuf + dataId * SDAQ_CONST_STAMP_LEN), (const void *)session -> stamp, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN);
+
+    /* hand over to the writer */
+    if(dataId == session -> dataCap.pulseNum - 1) {
+        if(session -> dataJob.state == SDAQ_CONST_WRITER_BUSY) {
+            SDAQ_func_handOverDataBuf(session, 0);
+            session -> dataJob.dropCnt ++;
+            EPICSLIB_func_errlogPrintf("SDAQ_func_saveData: Writer is still busy, %s is not saved\n", nameStr);
+            return -1;
         }
+
+        session -> dataJob.pulseNum = session -> dataCap.pulseNum;
+        SDAQ_func_handOverDataBuf(session, 1);
+        SDAQ_func_submitJob(session, &session -> dataJob, nameStr);
     }
 
     return 0;
 }
 
 /**
- * Save waveform 
+ * Save waveform. Similar as SDAQ_func_saveData, the length of the capture is SDAQ_func_getWfCaptureLen
+ * Return:
+ *     0                : Successful
+ *    -1                : Illegal input, no buffer, or the capture is dropped because the writer is still busy
  */
-int SDAQ_func_saveWf(int wfId, char *nameStr)
+int SDAQ_func_saveWf(SDAQ_struc_session *session, int wfId, char *nameStr)
 {
-    FILE *outFile               = NULL;
     SDAQ_struc_wfNode *ptr_wf   = NULL;
+    int i;
 
-    /* check the input (effective wfId should be in the range of [0, SDAQ_CONST_WF_NUM_SUPPORTED - 1] */
-    if(wfId < 0 || wfId >= SDAQ_CONST_WF_NUM_SUPPORTED || !nameStr || !nameStr[0]) return -1;
+    /* check the input (effective wfId should be in the range of [0, pulses of the capture - 1] */
+    if(wfId < 0 || wfId >= SDAQ_CONST_WF_NUM_SUPPORTED || !nameStr || !nameStr[0] || !session || session -> wfNodeNum <= 0) return -1;
 
-    /* save all waveform in the list */
-    for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(SDAQ_gvar_wfNodeList);
-        ptr_wf;
-        ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node)) {        
-            memcpy((void *)(ptr_wf -> buf + wfId * ptr_wf -> pno), (void *)(ptr_wf -> dataPtr), sizeof(short) * ptr_wf -> pno);     
+    /* select the nodes and get the buffers when the capture starts */
+    if(wfId == 0 && SDAQ_func_startWfCapture(session) != 0) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_saveWf: Failed to start the capture (no channel selected or no buffer)\n");
+        return -1;
     }
 
-    /* save to file */
-    if(wfId == SDAQ_CONST_WF_NUM_SUPPORTED - 1) {
+    if(wfId >= session -> wfCap.pulseNum) return -1;
 
-        outFile = fopen(nameStr, "w");
+    /* save the selected waveforms only */
+    for(i = 0; i < session -> wfSelNum; i ++) {
+        ptr_wf = session -> wfSel[i];
+        if(!ptr_wf -> buf) return -1;
+        memcpy((void *)(ptr_wf -> buf + wfId * ptr_wf -> pno), (void *)(ptr_wf -> dataPtr), sizeof(short) * ptr_wf -> pno);     
+    }
 
-        if(outFile) {
-            for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(SDAQ_gvar_wfNodeList);
-                ptr_wf;
-                ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node)) {        
-                    fwrite(ptr_wf -> buf, sizeof(short), SDAQ_CONST_WF_PNO_SUPPORTED * SDAQ_CONST_WF_NUM_SUPPORTED, outFile);
-            }       
+    memcpy((void *)(session -> wfStampBuf + wfId * SDAQ_CONST_STAMP_LEN), (const void *)session -> stamp, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN);
+
+    /* hand over to the writer */
+    if(wfId == session -> wfCap.pulseNum - 1) {
+        if(session -> wfJob.state == SDAQ_CONST_WRITER_BUSY) {
+            SDAQ_func_handOverWfBuf(session, 0);
+            session -> wfJob.dropCnt ++;
+            EPICSLIB_func_errlogPrintf("SDAQ_func_saveWf: Writer is still busy, %s is not saved\n", nameStr);
+            return -1;
+        }
+
+        session -> wfJob.pulseNum = session -> wfCap.pulseNum;
+        SDAQ_func_handOverWfBuf(session, 1);
+        SDAQ_func_submitJob(session, &session -> wfJob, nameStr);
+    }
+
+    return 0;
+}
+
+/**
+ * Get the state and progress of the data writer job
+ * Return:
+ *     SDAQ_CONST_WRITER_xxx
+ */
+int SDAQ_func_getDataWriteStatus(SDAQ_struc_session *session, long *percent)
+{
+    if(!session) return SDAQ_CONST_WRITER_FAILED;
+
+    if(percent) *percent = session -> dataJob.percent;
+    return session -> dataJob.state;
+}
+
+/**
+ * Get the state and progress of the waveform writer job
+ * Return:
+ *     SDAQ_CONST_WRITER_xxx
+ */
+int SDAQ_func_getWfWriteStatus(SDAQ_struc_session *session, long *percent)
+{
+    if(!session) return SDAQ_CONST_WRITER_FAILED;
+
+    if(percent) *percent = session -> wfJob.percent;
+    return session -> wfJob.state;
+}
+
+/**
+ * Start the streaming of the single value data of the session. Only one streaming per session is supported 
+ *   at a time, the records are pushed by the thread saving the data of the session
+ * Input:
+ *     session          : Session of the module
+ *     nameStr          : Base name of the files
+ *     rotateSize_MB    : Start a new file after this size, 0 for no limit
+ *     rotatePeriod_s   : Start a new file after this time, 0 for no limit
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
+ */
+int SDAQ_func_streamStart(SDAQ_struc_session *session, char *nameStr, double rotateSize_MB, double rotatePeriod_s)
+{
+    SDAQ_struc_stream *stream = NULL;
+
+    if(!session || !nameStr || !nameStr[0] || session -> dataNodeNum <= 0 || !session -> writerThread) return -1;
+
+    stream = &session -> stream;
+
+    if(stream -> state == SDAQ_CONST_STREAM_RUNNING || stream -> state == SDAQ_CONST_STREAM_STOPPING) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_streamStart: Streaming is already running\n");
+        return -1;
+    }
+
+    stream -> recordLen = SDAQ_CONST_STAMP_LEN + session -> dataNodeNum;
+    stream -> ring      = (double *)SDAQ_func_poolAlloc(sizeof(double) * SDAQ_CONST_STREAM_DEPTH * stream -> recordLen);
+
+    if(!stream -> ring) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_streamStart: Failed to get the ring from the pool\n");
+        return -1;
+    }
+
+    strncpy(stream -> baseName, nameStr, SDAQ_CONST_FILE_NAME_LEN - 1);
+    stream -> baseName[SDAQ_CONST_FILE_NAME_LEN - 1] = 0;
+
+    stream -> rotateSize_MB  = rotateSize_MB;
+    stream -> rotatePeriod_s = rotatePeriod_s;
+    stream -> head           = 0;
+    stream -> tail           = 0;
+    stream -> file           = NULL;
+    stream -> fileCnt        = 0;
+    stream -> dropCnt        = 0;
+
+    __sync_synchronize();                                   /* the settings must be visible before the state */
+    stream -> state          = SDAQ_CONST_STREAM_RUNNING;
+
+    return 0;
+}
+
+/**
+ * Stop the streaming, the writer will write the remaining records and close the file
+ */
+int SDAQ_func_streamStop(SDAQ_struc_session *session)
+{
+    if(!session || session -> stream.state != SDAQ_CONST_STREAM_RUNNING) return -1;
+
+    SDAQ_struc_stream *stream = &session -> stream;
+
+    stream -> state = SDAQ_CONST_STREAM_STOPPING;
+    epicsEventSignal(session -> writerEvent);
+
+    return 0;
+}
+
+/**
+ * Push the values of all data nodes of this pulse to the streaming ring
+ * Return:
+ *     0                : Successful, or no streaming running
+ *    -1                : The ring is full and the record is dropped (the writer can not follow)
+ */
+int SDAQ_func_streamSave(SDAQ_struc_session *session)
+{
+    SDAQ_struc_stream   *stream     = NULL;
+    SDAQ_struc_dataNode *ptr_data   = NULL;
+    double *ptr_record;
+    int status = 0;
+    int i      = 0;
+
+    if(!session || session -> stream.state != SDAQ_CONST_STREAM_RUNNING) return 0;
+
+    stream = &session -> stream;
 
-            fflush(outFile);
-            fclose(outFile);
+    stream -> inPush = 1;
+    __sync_synchronize();                                   /* the writer must see inPush before we check the state */
+
+    if(stream -> state == SDAQ_CONST_STREAM_RUNNING) {
+        if(stream -> head - stream -> tail >= SDAQ_CONST_STREAM_DEPTH) {
+            stream -> dropCnt ++;
+            status = -1;
+        } else {
+            ptr_record = stream -> ring + (stream -> head & (SDAQ_CONST_STREAM_DEPTH - 1)) * stream -> recordLen;
+
+            memcpy((void *)ptr_record, (const void *)session -> stamp, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN);  /* uint64 in the first slots */
+            i = SDAQ_CONST_STAMP_LEN;
+
+            for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList);
+                ptr_data && i < stream -> recordLen;
+                ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node)) {
+                    ptr_record[i ++] = *(ptr_data -> dataPtr);
+            }
+
+            __sync_synchronize();                           /* the record must be visible before the head */
+            stream -> head ++;
         }
     }
 
+    __sync_synchronize();
+    stream -> inPush = 0;
+
+    return status;
+}
+
+/**
+ * Get the state of the streaming
+ * Input:
+ *     fillPercent      : Fill level of the ring, the back pressure from the writer
+ *     dropCnt          : Records dropped because the ring was full
+ *     fileCnt          : Number of files opened
+ * Return:
+ *     SDAQ_CONST_STREAM_xxx
+ */
+int SDAQ_func_getStreamStatus(SDAQ_struc_session *session, long *fillPercent, long *dropCnt, long *fileCnt)
+{
+    if(!session) return SDAQ_CONST_STREAM_FAILED;
+
+    SDAQ_struc_stream *stream = &session -> stream;
+
+    if(fillPercent) *fillPercent = (long)((stream -> head - stream -> tail) * 100 / SDAQ_CONST_STREAM_DEPTH);
+    if(dropCnt)     *dropCnt     = stream -> dropCnt;
+    if(fileCnt)     *fileCnt     = stream -> fileCnt;
+
+    return stream -> state;
+}
+
+/**
+ * Enable the post-mortem buffer of the session. The buffers are got from the pool here, so that recording 
+ *   a pulse does not need any allocation
+ * Input:
+ *     session          : Session of the module
+ *     nameStr          : Base name of the dump files
+ *     pulseNum         : Pulses kept in the buffer
+ *     postNum          : Pulses recorded after the trigger, should be less than pulseNum
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
+ */
+int SDAQ_func_pmEnable(SDAQ_struc_session *session, char *nameStr, int pulseNum, int postNum)
+{
+    SDAQ_struc_postMortem *pm       = NULL;
+    SDAQ_struc_wfNode     *ptr_wf   = NULL;
+
+    if(!session || !nameStr || !nameStr[0] || !session -> writerThread) return -1;
+    if(pulseNum <= 0 || pulseNum > SDAQ_CONST_PM_PULSE_MAX || postNum < 0 || postNum >= pulseNum) return -1;
+
+    pm = &session -> pm;
+
+    if(pm -> state != SDAQ_CONST_PM_IDLE) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_pmEnable: Post-mortem buffer is already in use\n");
+        return -1;
+    }
+
+    /* size of the records */
+    pm -> dataLen = SDAQ_CONST_STAMP_LEN + session -> dataNodeNum;
+    pm -> wfLen   = 0;
+
+    for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList);
+        ptr_wf;
+        ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node)) {
+            pm -> wfLen += ptr_wf -> pno;
+    }
+
+    pm -> pulseNum = pulseNum;
+    pm -> dataRing = pm -> dataLen > 0 ? (double *)SDAQ_func_poolAlloc(sizeof(double) * pulseNum * pm -> dataLen) : NULL;
+    pm -> wfRing   = pm -> wfLen   > 0 ? (short  *)SDAQ_func_poolAlloc(sizeof(short)  * pulseNum * pm -> wfLen)   : NULL;
+
+    if((pm -> dataLen > 0 && !pm -> dataRing) || (pm -> wfLen > 0 && !pm -> wfRing)) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_pmEnable: Failed to get the buffers from the pool\n");
+        SDAQ_func_pmRelease(pm);
+        return -1;
+    }
+
+    strncpy(pm -> baseName, nameStr, SDAQ_CONST_FILE_NAME_LEN - 1);
+    pm -> baseName[SDAQ_CONST_FILE_NAME_LEN - 1] = 0;
+
+    pm -> postNum        = postNum;
+    pm -> pulseCnt       = 0;
+    pm -> postCnt        = 0;
+    pm -> dumpCnt        = 0;
+    pm -> disableRequest = 0;
+
+    __sync_synchronize();                                   /* the settings must be visible before the state */
+    pm -> state          = SDAQ_CONST_PM_ARMED;
+
     return 0;
 }
 
+/**
+ * Disable the post-mortem buffer. The buffers are given back by the thread saving the data in the next 
+ *   SDAQ_func_pmSave, or by the writer thread after the dump in progress
+ */
+int SDAQ_func_pmDisable(SDAQ_struc_session *session)
+{
+    if(!session || session -> pm.state == SDAQ_CONST_PM_IDLE) return -1;
 
+    session -> pm.disableRequest = 1;
 
+    return 0;
+}
 
+/**
+ * Record the values of all data nodes and the waveforms of all waveform nodes of this pulse. Only a bounded
+ *   copy into the circular buffer, no allocation
+ * Return:
+ *     0                : Successful
+ *    -1                : Not recorded (not enabled, or frozen for the dump)
+ */
+int SDAQ_func_pmSave(SDAQ_struc_session *session)
+{
+    SDAQ_struc_postMortem *pm       = NULL;
+    SDAQ_struc_dataNode   *ptr_data = NULL;
+    SDAQ_struc_wfNode     *ptr_wf   = NULL;
+    double *ptr_dataRecord;
+    short  *ptr_wfRecord;
+    int     var_state;
+    int     i = 0;
+    int     j = 0;
 
+    if(!session) return -1;
 
+    pm        = &session -> pm;
+    var_state = pm -> state;
 
+    if(var_state != SDAQ_CONST_PM_ARMED && var_state != SDAQ_CONST_PM_TRIGGERED) return -1;
 
+    /* disabled, the writer is not using the buffers in these states */
+    if(pm -> disableRequest) {
+        SDAQ_func_pmRelease(pm);
+        return -1;
+    }
 
+    ptr_dataRecord = pm -> dataRing ? pm -> dataRing + (pm -> pulseCnt % pm -> pulseNum) * pm -> dataLen : NULL;
+    ptr_wfRecord   = pm -> wfRing   ? pm -> wfRing   + (pm -> pulseCnt % pm -> pulseNum) * pm -> wfLen   : NULL;
+
+    if(ptr_dataRecord) {
+        memcpy((void *)ptr_dataRecord, (const void *)session -> stamp, sizeof(uint64_t) * SDAQ_CONST_STAMP_LEN);  /* uint64 in the first slots */
+        i = SDAQ_CONST_STAMP_LEN;
+
+        for(ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindFirst(session -> dataNodeList);
+            ptr_data && i < pm -> dataLen;
+            ptr_data = (SDAQ_struc_dataNode *)EPICSLIB_func_LinkedListFindNext(ptr_data -> node)) {
+                ptr_dataRecord[i ++] = *(ptr_data -> dataPtr);
+        }
+    }
+
+    if(ptr_wfRecord) {
+        for(ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindFirst(session -> wfNodeList);
+            ptr_wf && j + ptr_wf -> pno <= pm -> wfLen;
+            ptr_wf = (SDAQ_struc_wfNode *)EPICSLIB_func_LinkedListFindNext(ptr_wf -> node)) {
+                memcpy((void *)(ptr_wfRecord + j), (void *)(ptr_wf -> dataPtr), sizeof(short) * ptr_wf -> pno);
+                j += ptr_wf -> pno;
+        }
+    }
+
+    pm -> pulseCnt ++;
+
+    /* freeze and hand over to the writer when all post-trigger pulses are recorded */
+    if(var_state == SDAQ_CONST_PM_TRIGGERED && -- pm -> postCnt <= 0) {
+        __sync_synchronize();
+        pm -> state = SDAQ_CONST_PM_DUMPING;
+        epicsEventSignal(session -> writerEvent);
+    }
+
+    return 0;
+}
+
+/**
+ * Trigger the post-mortem buffer, the postNum following pulses will be recorded before the dump. Ignored
+ *   if already triggered or being dumped
+ * Return:
+ *     0                : Triggered
+ *    -1                : Ignored
+ */
+int SDAQ_func_pmTrigger(SDAQ_struc_session *session)
+{
+    if(!session || session -> pm.state != SDAQ_CONST_PM_ARMED) return -1;
+
+    SDAQ_struc_postMortem *pm = &session -> pm;
+
+    if(pm -> postNum <= 0) {                                /* no post-trigger pulses, dump right now */
+        pm -> state   = SDAQ_CONST_PM_DUMPING;
+        epicsEventSignal(session -> writerEvent);
+    } else {
+        pm -> postCnt = pm -> postNum;
+        pm -> state   = SDAQ_CONST_PM_TRIGGERED;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the state of the post-mortem buffer
+ * Return:
+ *     SDAQ_CONST_PM_xxx
+ */
+int SDAQ_func_getPmStatus(SDAQ_struc_session *session, long *dumpCnt)
+{
+    if(!session) return SDAQ_CONST_PM_IDLE;
+
+    if(dumpCnt) *dumpCnt = session -> pm.dumpCnt;
+    return session -> pm.state;
+}
 
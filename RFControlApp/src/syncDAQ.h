@@ -14,9 +14,44 @@
 #define SDAQ_CONST_BUF_SIZE             65536               /* 64K points supported in single value DAQ buffer */
 #define SDAQ_CONST_WF_PNO_SUPPORTED     1024                /* support 512 point waveforms */
 #define SDAQ_CONST_WF_NUM_SUPPORTED     2048                /* maximum 2048 waveforms can be saved */
+#define SDAQ_CONST_PAGE_SIZE            4096                /* stride for pre-faulting the buffers */
+#define SDAQ_CONST_NODE_MAX             64                  /* maximum data nodes and waveform nodes in a session (bits of the channel mask) */
+#define SDAQ_CONST_STAMP_LEN            2                   /* stamp of a pulse: pulse counter and timestamp, written as the first channels of the files */
+#define SDAQ_CONST_CAPTURE_RESERVE_NUM  2                   /* sets of capture buffers reserved in the pool: the running capture and the one being written */
+
+#define SDAQ_CONST_FILE_NAME_LEN        256
+#define SDAQ_CONST_WRITER_PRIORITY      10                  /* low priority, the writer should not disturb the real-time threads */
+
+#define SDAQ_CONST_WRITER_IDLE          0                   /* state of the writer job */
+#define SDAQ_CONST_WRITER_BUSY          1
+#define SDAQ_CONST_WRITER_DONE          2
+#define SDAQ_CONST_WRITER_FAILED        3
+
+#define SDAQ_CONST_STREAM_DEPTH         4096                /* records buffered for the streaming writer (34 s at 120 Hz), must be power of 2 */
+#define SDAQ_CONST_STREAM_DRAIN_PERIOD  0.2                 /* period in seconds for the writer to drain the streaming ring */
+
+#define SDAQ_CONST_STREAM_IDLE          0                   /* state of the streaming */
+#define SDAQ_CONST_STREAM_RUNNING       1
+#define SDAQ_CONST_STREAM_STOPPING      2                   /* stop requested, the writer drains the ring and closes the file */
+#define SDAQ_CONST_STREAM_FAILED        3
+
+#define SDAQ_CONST_PM_PULSE_MAX         2048                /* maximum pulses kept by the post-mortem buffer */
+
+#define SDAQ_CONST_PM_IDLE              0                   /* state of the post-mortem buffer */
+#define SDAQ_CONST_PM_ARMED             1                   /* recording every pulse */
+#define SDAQ_CONST_PM_TRIGGERED         2                   /* recording the post-trigger pulses */
+#define SDAQ_CONST_PM_DUMPING           3                   /* frozen, being written by the writer thread, re-armed afterwards */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <epicsEvent.h>
+#include <epicsMutex.h>
 
 #include "MathLib_dataProcess.h"
 #include "EPICSLib_wrapper.h"
+#include "syncDAQ_pool.h"
+#include "syncDAQ_file.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,7 +67,9 @@ extern "C" {
 typedef struct {
     EPICSLIB_type_linkedListNode node;                      /* to fit this structure to linked list */
     volatile double *dataPtr;                               /* pointer to the data */
-    double buf[SDAQ_CONST_BUF_SIZE];                        /* buffer for the data */
+    char name[SDAQ_CONST_CH_NAME_LEN];                      /* channel name in the files */
+    double *buf;                                            /* capture buffer (SDAQ_CONST_BUF_SIZE points) got from the pool when a capture starts */
+    double *bufWrite;                                       /* buffer of the completed capture, owned by the writer until given back to the pool */
 } SDAQ_struc_dataNode;
 
 /**
@@ -42,18 +79,175 @@ typedef struct {
 typedef struct {
     EPICSLIB_type_linkedListNode node;                                      /* to fit this structure to linked list */
     volatile short *dataPtr;                                                /* pointer to the data */
+    char name[SDAQ_CONST_CH_NAME_LEN];                                      /* channel name in the files */
     int pno;                                                                /* real point number */
-    short buf[SDAQ_CONST_WF_PNO_SUPPORTED * SDAQ_CONST_WF_NUM_SUPPORTED];   /* buffer for the data */
+    short *buf;                                                             /* capture buffer (SDAQ_CONST_WF_PNO_SUPPORTED * SDAQ_CONST_WF_NUM_SUPPORTED points) got from the pool */
+    short *bufWrite;                                                        /* buffer of the completed capture, owned by the writer */
 } SDAQ_struc_wfNode;
 
+/**
+ * Settings of a capture, latched when the capture starts
+ */
+typedef struct {
+    uint64_t chMask;                                        /* bit i selects the node i (in the order of creation) */
+    int      pulseNum;                                      /* pulses to be captured */
+} SDAQ_struc_capture;
+
+/**
+ * Blocks reserved in the pool for a capture: the stamps and the buffers of the selected nodes
+ */
+typedef struct {
+    int    blockNum;
+    size_t blockSize[SDAQ_CONST_NODE_MAX + 1];
+} SDAQ_struc_reserve;
+
+/**
+ * Job of the background writer. When a capture is completed, the buffers are handed to the writer
+ *   and the next capture gets new buffers from the pool, so the real-time thread never waits for the file
+ */
+typedef struct {
+    volatile int  state;                                    /* SDAQ_CONST_WRITER_xxx */
+    volatile long percent;                                  /* progress of the writing */
+    volatile long dropCnt;                                  /* completed captures dropped because the writer was still busy */
+    int  pulseNum;                                          /* pulses in the buffers of the job */
+    char fileName[SDAQ_CONST_FILE_NAME_LEN];
+} SDAQ_struc_writeJob;
+
+/**
+ * Streaming of the single value data. Each pulse, a record with the values of all data nodes is put into a
+ *   lock-free ring (single producer: the thread saving the data, single consumer: the writer thread), and the writer 
+ *   drains the ring into files rotated by size or time until stopped. The files are named <baseName>_NNNN
+ *   and contain the records one after another (stamp and all nodes of pulse 1, stamp and all nodes of pulse 2, ...)
+ */
+typedef struct {
+    volatile int  state;                                    /* SDAQ_CONST_STREAM_xxx */
+    volatile int  inPush;                                   /* 1 while the producer is accessing the ring */
+
+    volatile unsigned long head;                            /* records pushed by the producer */
+    volatile unsigned long tail;                            /* records written by the writer */
+    double *ring;                                           /* SDAQ_CONST_STREAM_DEPTH records, from the pool */
+    int     recordLen;                                      /* number of values in a record (stamp of the pulse, then the data nodes) */
+
+    char    baseName[SDAQ_CONST_FILE_NAME_LEN];
+    double  rotateSize_MB;                                  /* start a new file after this size, 0 for no limit */
+    double  rotatePeriod_s;                                 /* start a new file after this time, 0 for no limit */
+
+    FILE   *file;                                           /* used by the writer only */
+    size_t  fileBytes;
+    time_t  fileTime;
+
+    volatile long fileCnt;                                  /* number of files opened */
+    volatile long dropCnt;                                  /* records dropped because the ring was full */
+} SDAQ_struc_stream;
+
+/**
+ * Post-mortem buffer. The values of all data nodes and the waveforms of all waveform nodes of the last pulses
+ *   are kept in a circular buffer. When triggered, postNum more pulses are recorded, then the buffer is frozen
+ *   and written by the writer thread to <baseName>_NNNN, and re-armed. The file contains the data records 
+ *   (stamp and all data nodes per pulse) of the pulses from the oldest to the newest, followed by the waveform records 
+ *   (all waveform nodes per pulse) in the same order
+ */
+typedef struct {
+    volatile int  state;                                    /* SDAQ_CONST_PM_xxx */
+    volatile int  disableRequest;                           /* executed by the thread saving the data (or the writer after a dump) */
+
+    int     pulseNum;                                       /* pulses kept in the buffer */
+    int     postNum;                                        /* pulses recorded after the trigger */
+    int     dataLen;                                        /* values in a data record (stamp of the pulse, then the data nodes) */
+    int     wfLen;                                          /* points in a waveform record */
+    double *dataRing;                                       /* pulseNum data records, from the pool */
+    short  *wfRing;                                         /* pulseNum waveform records, from the pool */
+
+    unsigned long pulseCnt;                                 /* pulses recorded since armed */
+    int     postCnt;                                        /* post-trigger pulses still to be recorded */
+
+    char    baseName[SDAQ_CONST_FILE_NAME_LEN];
+    volatile long dumpCnt;                                  /* number of dumps written */
+} SDAQ_struc_postMortem;
+
+/**
+ * Session of the synchronized data aquisition. Each module instance owns a session with its own nodes,
+ *   captures, streaming, post-mortem buffer and writer thread, so that the modules in the same IOC do not
+ *   sample the data of each other or write to the same files. Only the buffer pool is shared
+ */
+typedef struct {
+    char name[SDAQ_CONST_CH_NAME_LEN];                      /* name of the session (module name) */
+
+    EPICSLIB_type_linkedList dataNodeList;                  /* nodes of the session */
+    EPICSLIB_type_linkedList wfNodeList;
+    int dataNodeNum;
+    int wfNodeNum;
+
+    SDAQ_struc_capture    dataCapReq;                       /* settings for the next capture, set by the user */
+    SDAQ_struc_capture    wfCapReq;
+    SDAQ_struc_capture    dataCap;                          /* settings of the running capture */
+    SDAQ_struc_capture    wfCap;
+    SDAQ_struc_reserve    dataRes;                          /* blocks reserved in the pool for the captures with the settings of the user */
+    SDAQ_struc_reserve    wfRes;
+    epicsMutexId          resMutex;
+    SDAQ_struc_dataNode  *dataSel[SDAQ_CONST_NODE_MAX];     /* nodes selected by the running capture, only they are copied per pulse */
+    SDAQ_struc_wfNode    *wfSel[SDAQ_CONST_NODE_MAX];
+    int dataSelNum;
+    int wfSelNum;
+
+    SDAQ_struc_writeJob   dataJob;                          /* background writer */
+    SDAQ_struc_writeJob   wfJob;
+    SDAQ_struc_stream     stream;
+    SDAQ_struc_postMortem pm;
+
+    int fileLayout;                                         /* layout of the capture and post-mortem files (the streaming files are always pulse-major) */
+    int codec;                                              /* compression of the capture and post-mortem files */
+    volatile double codecRatio;                             /* statistics of the last compressed file */
+    volatile double codecSpeed_MBps;
+
+    uint64_t  stamp[SDAQ_CONST_STAMP_LEN];                  /* pulse counter and host time (ns) of the current pulse, see SDAQ_func_setPulseStamp */
+    char      stampName[SDAQ_CONST_STAMP_LEN][SDAQ_CONST_CH_NAME_LEN];  /* channel names of the stamp in the files */
+    uint64_t *dataStampBuf;                                 /* stamps of the running captures (SDAQ_CONST_STAMP_LEN per pulse), from the pool */
+    uint64_t *wfStampBuf;
+    uint64_t *dataStampWrite;                               /* stamps of the completed captures, owned by the writer */
+    uint64_t *wfStampWrite;
+
+    epicsEventId           writerEvent;
+    EPICSLIB_type_threadId writerThread;
+} SDAQ_struc_session;
+
 /*======================================
  * Routines
  *======================================*/     
-int SDAQ_func_createDataNode(double *dataPtr);
-int SDAQ_func_createWfNode(short *dataPtr, int pno);
+int SDAQ_func_sessionInit(SDAQ_struc_session *session, const char *name);
+
+int SDAQ_func_createDataNode(SDAQ_struc_session *session, double *dataPtr, const char *name);
+int SDAQ_func_createWfNode(SDAQ_struc_session *session, short *dataPtr, int pno, const char *name);
+int SDAQ_func_reserve(SDAQ_struc_session *session);
+int SDAQ_func_prefault(SDAQ_struc_session *session);
+
+void SDAQ_func_setFileLayout(SDAQ_struc_session *session, int layout);     /* SDAQ_CONST_LAYOUT_xxx for the capture and post-mortem files */
+int  SDAQ_func_setCodec(SDAQ_struc_session *session, int codec);           /* SDAQ_CONST_CODEC_xxx for the capture and post-mortem files */
+int  SDAQ_func_getCodecStat(SDAQ_struc_session *session, double *ratio, double *speed_MBps);
+
+int SDAQ_func_setDataCapture(SDAQ_struc_session *session, uint64_t chMask, int pulseNum);  /* applied to the next capture */
+int SDAQ_func_setWfCapture(SDAQ_struc_session *session, uint64_t chMask, int pulseNum);
+int SDAQ_func_getDataCaptureLen(SDAQ_struc_session *session);                              /* pulses of the running capture */
+int SDAQ_func_getWfCaptureLen(SDAQ_struc_session *session);
+
+void SDAQ_func_setPulseStamp(SDAQ_struc_session *session, uint64_t pulseCnt, uint64_t time_ns);  /* called per pulse before saving */
+
+int SDAQ_func_saveData(SDAQ_struc_session *session, int dataId, char *nameStr);
+int SDAQ_func_saveWf(SDAQ_struc_session *session, int wfId, char *nameStr);
+
+int SDAQ_func_getDataWriteStatus(SDAQ_struc_session *session, long *percent);  /* return the state of the data writer job */
+int SDAQ_func_getWfWriteStatus(SDAQ_struc_session *session, long *percent);    /* return the state of the waveform writer job */
+
+int SDAQ_func_streamStart(SDAQ_struc_session *session, char *nameStr, double rotateSize_MB, double rotatePeriod_s);
+int SDAQ_func_streamStop(SDAQ_struc_session *session);
+int SDAQ_func_streamSave(SDAQ_struc_session *session);                      /* called per pulse by the thread saving the data */
+int SDAQ_func_getStreamStatus(SDAQ_struc_session *session, long *fillPercent, long *dropCnt, long *fileCnt);
 
-int SDAQ_func_saveData(int dataId, char *nameStr);
-int SDAQ_func_saveWf(int wfId, char *nameStr);
+int SDAQ_func_pmEnable(SDAQ_struc_session *session, char *nameStr, int pulseNum, int postNum);
+int SDAQ_func_pmDisable(SDAQ_struc_session *session);
+int SDAQ_func_pmSave(SDAQ_struc_session *session);                          /* called per pulse by the thread saving the data */
+int SDAQ_func_pmTrigger(SDAQ_struc_session *session);                       /* called by the thread saving the data when a trigger condition fires */
+int SDAQ_func_getPmStatus(SDAQ_struc_session *session, long *dumpCnt);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,393 @@
+/****************************************************
+ * syncDAQ_codec.c
+ *
+ * Source file for the lossless codec of the synchronized data aquisition files
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "syncDAQ_codec.h"
+
+#define SDAQ_CONST_CODEC_MIN_MATCH      4                   /* limits of the LZ4 block format */
+#define SDAQ_CONST_CODEC_LAST_LITERALS  5                   /* the last bytes of a block are always literals */
+#define SDAQ_CONST_CODEC_MATCH_LIMIT    12                  /* the last match starts at least this number of bytes before the end */
+#define SDAQ_CONST_CODEC_MAX_OFFSET     65535
+
+#define SDAQ_CONST_CODEC_TEST_PNO       1024                /* points per pulse of the waveforms used by the self test */
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Hash of a 4 bytes sequence
+ */
+static unsigned int SDAQ_func_codecHash(const unsigned char *p)
+{
+    uint32_t var_seq;
+
+    memcpy((void *)&var_seq, (const void *)p, sizeof(uint32_t));
+
+    return (unsigned int)((var_seq * 2654435761U) >> (32 - SDAQ_CONST_CODEC_HASH_BITS));
+}
+
+/**
+ * Write the extra bytes of a length (the part not fit into the token)
+ */
+static unsigned char *SDAQ_func_codecPutLen(unsigned char *op, size_t len)
+{
+    while(len >= 255) {
+        *op++ = 255;
+        len  -= 255;
+    }
+
+    *op++ = (unsigned char)len;
+
+    return op;
+}
+
+/**
+ * Write a sequence: literals followed by a match (matchLen 0 for the last sequence with literals only)
+ */
+static unsigned char *SDAQ_func_codecPutSeq(unsigned char *op, const unsigned char *lit, size_t litLen, size_t offset, size_t matchLen)
+{
+    unsigned char *ptr_token = op++;
+    size_t         var_mlen  = matchLen ? matchLen - SDAQ_CONST_CODEC_MIN_MATCH : 0;
+
+    *ptr_token = (unsigned char)(((litLen < 15 ? litLen : 15) << 4) | (var_mlen < 15 ? var_mlen : 15));
+
+    if(litLen >= 15) op = SDAQ_func_codecPutLen(op, litLen - 15);
+
+    memcpy((void *)op, (const void *)lit, litLen);
+    op += litLen;
+
+    if(matchLen) {
+        *op++ = (unsigned char)(offset & 0xff);
+        *op++ = (unsigned char)(offset >> 8);
+
+        if(var_mlen >= 15) op = SDAQ_func_codecPutLen(op, var_mlen - 15);
+    }
+
+    return op;
+}
+
+/**
+ * LZ coding of a block in the LZ4 block format
+ * Return:
+ *     size of the coded block
+ */
+static size_t SDAQ_func_codecLZ(uint16_t *hash, const unsigned char *in, size_t inBytes, unsigned char *out)
+{
+    unsigned char *op       = out;
+    size_t         var_ip   = 0;
+    size_t         var_anchor = 0;
+    size_t         var_ref;
+    size_t         var_len;
+    size_t         var_miss = 0;
+    unsigned int   var_h;
+
+    memset((void *)hash, 0, sizeof(uint16_t) << SDAQ_CONST_CODEC_HASH_BITS);
+
+    if(inBytes > SDAQ_CONST_CODEC_MATCH_LIMIT) {
+        while(var_ip < inBytes - SDAQ_CONST_CODEC_MATCH_LIMIT) {
+            var_h       = SDAQ_func_codecHash(in + var_ip);
+            var_ref     = hash[var_h];
+            hash[var_h] = (uint16_t)var_ip;
+
+            if(var_ref < var_ip && var_ip - var_ref <= SDAQ_CONST_CODEC_MAX_OFFSET && memcmp(in + var_ref, in + var_ip, SDAQ_CONST_CODEC_MIN_MATCH) == 0) {
+
+                var_len = SDAQ_CONST_CODEC_MIN_MATCH;
+                while(var_ip + var_len < inBytes - SDAQ_CONST_CODEC_LAST_LITERALS && in[var_ref + var_len] == in[var_ip + var_len]) var_len ++;
+
+                op = SDAQ_func_codecPutSeq(op, in + var_anchor, var_ip - var_anchor, var_ip - var_ref, var_len);
+
+                var_ip    += var_len;
+                var_anchor = var_ip;
+                var_miss   = 0;
+
+            } else {
+                var_ip += 1 + (var_miss ++ >> 6);                   /* skip faster in the data not compressible */
+            }
+        }
+    }
+
+    op = SDAQ_func_codecPutSeq(op, in + var_anchor, inBytes - var_anchor, 0, 0);
+
+    return (size_t)(op - out);
+}
+
+/**
+ * LZ decoding of a block in the LZ4 block format
+ * Return:
+ *     0                : Successful
+ *    -1                : Corrupted block
+ */
+static int SDAQ_func_codecUnLZ(const unsigned char *in, size_t inBytes, unsigned char *out, size_t outBytes)
+{
+    const unsigned char *ip     = in;
+    const unsigned char *iend   = in + inBytes;
+    unsigned char       *op     = out;
+    unsigned char       *oend   = out + outBytes;
+    size_t var_len;
+    size_t var_offset;
+    unsigned char var_token;
+    unsigned char var_byte;
+
+    while(ip < iend) {
+        var_token = *ip++;
+
+        /* literals */
+        var_len = var_token >> 4;
+        if(var_len == 15) {
+            do {
+                if(ip >= iend) return -1;
+                var_byte = *ip++;
+                var_len += var_byte;
+            } while(var_byte == 255);
+        }
+
+        if(var_len > (size_t)(iend - ip) || var_len > (size_t)(oend - op)) return -1;
+
+        memcpy((void *)op, (const void *)ip, var_len);
+        op += var_len;
+        ip += var_len;
+
+        if(ip >= iend) break;                                                       /* last sequence */
+
+        /* match */
+        if(iend - ip < 2) return -1;
+        var_offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+
+        if(var_offset == 0 || var_offset > (size_t)(op - out)) return -1;
+
+        var_len = var_token & 15;
+        if(var_len == 15) {
+            do {
+                if(ip >= iend) return -1;
+                var_byte = *ip++;
+                var_len += var_byte;
+            } while(var_byte == 255);
+        }
+        var_len += SDAQ_CONST_CODEC_MIN_MATCH;
+
+        if(var_len > (size_t)(oend - op)) return -1;
+
+        for(; var_len > 0; var_len --, op ++) *op = *(op - var_offset);             /* can overlap */
+    }
+
+    return (op == oend) ? 0 : -1;
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Code a block
+ * Input:
+ *     codec            : Working memory
+ *     elemSize         : Size of the elements in bytes (2 for short, 8 for double)
+ *     delta            : 1 to apply the delta coding (only for elemSize 2)
+ *     in               : Raw data
+ *     inBytes          : Size of the raw data, not larger than SDAQ_CONST_CODEC_BLOCK_SIZE and multiple of elemSize
+ *     out              : Coded data, SDAQ_CONST_CODEC_BOUND(inBytes) bytes should be available
+ * Return:
+ *     0                : Failed or the block is not compressible, should be stored raw
+ *     others           : Size of the coded data (smaller than inBytes)
+ */
+size_t SDAQ_func_codecEncode(SDAQ_struc_codec *codec, int elemSize, int delta, const void *in, size_t inBytes, void *out)
+{
+    const unsigned char *ptr_in = (const unsigned char *)in;
+    size_t   var_num;
+    size_t   var_outBytes;
+    size_t   i;
+    int      b;
+    int16_t  var_val;
+    uint16_t var_prev = 0;
+    uint16_t var_diff;
+
+    if(!codec || !in || !out || elemSize <= 0 || inBytes == 0 || inBytes > SDAQ_CONST_CODEC_BLOCK_SIZE || inBytes % elemSize) return 0;
+
+    var_num = inBytes / elemSize;
+
+    /* delta, zigzag and shuffle */
+    if(delta && elemSize == 2) {
+        for(i = 0; i < var_num; i ++) {
+            memcpy((void *)&var_val, (const void *)(ptr_in + 2 * i), 2);
+
+            var_diff = (uint16_t)((uint16_t)var_val - var_prev);
+            var_prev = (uint16_t)var_val;
+            var_diff = (uint16_t)((var_diff << 1) ^ (0 - (var_diff >> 15)));
+
+            codec -> tmp[i]           = (unsigned char)(var_diff & 0xff);
+            codec -> tmp[var_num + i] = (unsigned char)(var_diff >> 8);
+        }
+    } else {
+        for(i = 0; i < var_num; i ++)
+            for(b = 0; b < elemSize; b ++)
+                codec -> tmp[b * var_num + i] = ptr_in[i * elemSize + b];
+    }
+
+    /* LZ */
+    var_outBytes = SDAQ_func_codecLZ(codec -> hash, codec -> tmp, inBytes, (unsigned char *)out);
+
+    return (var_outBytes < inBytes) ? var_outBytes : 0;
+}
+
+/**
+ * Decode a block coded by SDAQ_func_codecEncode
+ * Input:
+ *     elemSize, delta  : Same as used for the coding
+ *     in, inBytes      : Coded data
+ *     out, outBytes    : Raw data and its size
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
+ */
+int SDAQ_func_codecDecode(int elemSize, int delta, const void *in, size_t inBytes, void *out, size_t outBytes)
+{
+    unsigned char *ptr_out = (unsigned char *)out;
+    unsigned char *ptr_tmp = NULL;
+    size_t   var_num;
+    size_t   i;
+    int      b;
+    uint16_t var_val = 0;
+    uint16_t var_diff;
+
+    if(!in || !out || elemSize <= 0 || outBytes == 0 || outBytes % elemSize) return -1;
+
+    ptr_tmp = (unsigned char *)malloc(outBytes);
+    if(!ptr_tmp) return -1;
+
+    if(SDAQ_func_codecUnLZ((const unsigned char *)in, inBytes, ptr_tmp, outBytes) != 0) {
+        free(ptr_tmp);
+        return -1;
+    }
+
+    var_num = outBytes / elemSize;
+
+    if(delta && elemSize == 2) {
+        for(i = 0; i < var_num; i ++) {
+            var_diff = (uint16_t)(ptr_tmp[i] | (ptr_tmp[var_num + i] << 8));
+            var_diff = (uint16_t)((var_diff >> 1) ^ (0 - (var_diff & 1)));
+            var_val  = (uint16_t)(var_val + var_diff);
+
+            memcpy((void *)(ptr_out + 2 * i), (const void *)&var_val, 2);
+        }
+    } else {
+        for(i = 0; i < var_num; i ++)
+            for(b = 0; b < elemSize; b ++)
+                ptr_out[i * elemSize + b] = ptr_tmp[b * var_num + i];
+    }
+
+    free(ptr_tmp);
+
+    return 0;
+}
+
+/**
+ * Code and decode one block and compare the result with the raw data bit by bit. Blocks that are not compressible
+ *   are stored raw in the files, so only the coded blocks are decoded
+ */
+static int SDAQ_func_codecCheckBlock(SDAQ_struc_codec *codec, unsigned char *coded, unsigned char *decoded, int elemSize, int delta, const void *in, size_t inBytes)
+{
+    size_t var_size = SDAQ_func_codecEncode(codec, elemSize, delta, in, inBytes, coded);
+
+    if(var_size == 0) return 0;
+
+    if(SDAQ_func_codecDecode(elemSize, delta, coded, var_size, decoded, inBytes) != 0) return -1;
+
+    return memcmp(in, decoded, inBytes) == 0 ? 0 : -1;
+}
+
+/**
+ * Run the self test with the buffers allocated by SDAQ_func_codecSelfTest, return the number of failed blocks
+ */
+static int SDAQ_func_codecRunTest(SDAQ_struc_codec *codec, unsigned char *raw, unsigned char *coded, unsigned char *decoded)
+{
+    short    *ptr_short  = (short *)raw;
+    double   *ptr_double = (double *)raw;
+    uint64_t *ptr_stamp  = (uint64_t *)raw;
+    uint32_t  var_rand   = 12345;
+    size_t    var_num;
+    size_t    i;
+    double    var_val;
+    int       var_failCnt = 0;
+
+    /* RF pulses (3 cycles in 14 points) with noise, the pulses in the second half clip at the full scale */
+    var_num = SDAQ_CONST_CODEC_BLOCK_SIZE / sizeof(short);
+
+    for(i = 0; i < var_num; i ++) {
+        var_rand = var_rand * 1103515245u + 12345u;
+        var_val  = ((i % SDAQ_CONST_CODEC_TEST_PNO) >= 100 && (i % SDAQ_CONST_CODEC_TEST_PNO) < 900) ? 20000.0 * (1 + i / (var_num / 2)) : 0;
+        var_val  = var_val * cos(2 * M_PI * 3 * i / 14) + (double)((var_rand >> 16) % 17) - 8;
+
+        if(var_val >  32767) var_val =  32767;
+        if(var_val < -32768) var_val = -32768;
+        ptr_short[i] = (short)var_val;
+    }
+
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 1, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 1, raw, 14 * sizeof(short));       /* short blocks */
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 1, raw, 3 * sizeof(short));
+
+    /* ADC noise only (not compressible) and constant data */
+    for(i = 0; i < var_num; i ++) {
+        var_rand = var_rand * 1103515245u + 12345u;
+        ptr_short[i] = (short)(var_rand >> 16);
+    }
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 1, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+
+    memset((void *)raw, 0, SDAQ_CONST_CODEC_BLOCK_SIZE);
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 1, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(short), 0, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+
+    /* slowly changing doubles (amplitude and phase of the pulses), with the special values */
+    var_num = SDAQ_CONST_CODEC_BLOCK_SIZE / sizeof(double);
+
+    for(i = 0; i < var_num; i ++) ptr_double[i] = 30.0 + 0.01 * sin(i * 0.001) + 1e-6 * (double)(i % 7);
+
+    ptr_double[1] = NAN;
+    ptr_double[2] = INFINITY;
+    ptr_double[3] = -0.0;
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(double), 0, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+
+    /* pulse stamps (pulse counter and time) */
+    for(i = 0; i + 1 < var_num; i += 2) {
+        ptr_stamp[i]     = 4000000000ull + i / 2;
+        ptr_stamp[i + 1] = 1000000000000ull + (uint64_t)(i / 2) * 8333333ull;
+    }
+    var_failCnt -= SDAQ_func_codecCheckBlock(codec, coded, decoded, sizeof(uint64_t), 0, raw, SDAQ_CONST_CODEC_BLOCK_SIZE);
+
+    return var_failCnt;
+}
+
+/**
+ * Self test of the codec. Representative data of the files (RF pulses of the ADC channels, including the
+ *   clipping at full scale, ADC noise, constant data, slowly changing doubles with the special values and the
+ *   pulse stamps) is coded and decoded, the decoded data must be the same as the raw data bit by bit
+ * Return:
+ *     0                : All blocks are decoded correctly
+ *    -1                : Failed
+ */
+int SDAQ_func_codecSelfTest(void)
+{
+    SDAQ_struc_codec *ptr_codec   = (SDAQ_struc_codec *)malloc(sizeof(SDAQ_struc_codec));
+    unsigned char    *ptr_raw     = (unsigned char *)malloc(SDAQ_CONST_CODEC_BLOCK_SIZE);
+    unsigned char    *ptr_coded   = (unsigned char *)malloc(SDAQ_CONST_CODEC_BOUND(SDAQ_CONST_CODEC_BLOCK_SIZE));
+    unsigned char    *ptr_decoded = (unsigned char *)malloc(SDAQ_CONST_CODEC_BLOCK_SIZE);
+    int status = -1;
+
+    if(ptr_codec && ptr_raw && ptr_coded && ptr_decoded)
+        status = (SDAQ_func_codecRunTest(ptr_codec, ptr_raw, ptr_coded, ptr_decoded) == 0) ? 0 : -1;
+
+    free(ptr_codec);
+    free(ptr_raw);
+    free(ptr_coded);
+    free(ptr_decoded);
+
+    return status;
+}
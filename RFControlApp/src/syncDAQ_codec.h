@@ -0,0 +1,56 @@
+/****************************************************
+ * syncDAQ_codec.h
+ *
+ * Header file for the lossless codec of the synchronized data aquisition files.
+ *   A block of a channel (SDAQ_CONST_CODEC_BLOCK_SIZE bytes at most) is coded in 3 steps:
+ *     - delta           : (short channels only) difference to the previous point, then zigzag coded so
+ *                         that the small negative values also have zero high bytes
+ *     - byte shuffle    : byte 0 of all elements, then byte 1 of all elements, ...
+ *     - LZ              : LZ77 coder writing the LZ4 block format, so the blocks can also be decoded
+ *                         by the standard lz4 libraries in the analysis tools
+ *   The RF pulse waveforms are smooth, so after the first 2 steps most bytes are 0 or repeat
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef SYNC_DAQ_CODEC_H
+#define SYNC_DAQ_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SDAQ_CONST_CODEC_NONE           0                   /* codec of the channels in the files */
+#define SDAQ_CONST_CODEC_SHUFFLE_LZ     1
+
+#define SDAQ_CONST_CODEC_BLOCK_SIZE     65536               /* raw bytes of a block, the LZ offsets are 16 bits so not larger than 64 kB */
+#define SDAQ_CONST_CODEC_HASH_BITS      13
+#define SDAQ_CONST_CODEC_BOUND(n)       ((n) + (n) / 255 + 16)  /* worst case size of a coded block */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Working memory of the coder, one for each thread using it
+ */
+typedef struct {
+    uint16_t      hash[1 << SDAQ_CONST_CODEC_HASH_BITS];    /* last position of a 4 bytes sequence in the block */
+    unsigned char tmp[SDAQ_CONST_CODEC_BLOCK_SIZE];         /* block after delta and shuffle */
+} SDAQ_struc_codec;
+
+/*======================================
+ * Routines
+ *======================================*/
+size_t SDAQ_func_codecEncode(SDAQ_struc_codec *codec, int elemSize, int delta, const void *in, size_t inBytes, void *out);
+int    SDAQ_func_codecDecode(int elemSize, int delta, const void *in, size_t inBytes, void *out, size_t outBytes);
+int    SDAQ_func_codecSelfTest(void);                                   /* code and decode representative data, 0 if bit exact */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
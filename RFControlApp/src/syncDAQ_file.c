@@ -0,0 +1,392 @@
+/****************************************************
+ * syncDAQ_file.c
+ * 
+ * Source file for the file format of the synchronized data aquisition. 
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "EPICSLib_wrapper.h"
+#include "syncDAQ_file.h"
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Working memory for writing the compressed channels
+ */
+typedef struct {
+    SDAQ_struc_codec codec;
+    unsigned char    raw[SDAQ_CONST_CODEC_BLOCK_SIZE];                          /* raw data of the block being filled */
+    unsigned char    out[SDAQ_CONST_CODEC_BOUND(SDAQ_CONST_CODEC_BLOCK_SIZE)];  /* coded block */
+} SDAQ_struc_fileCoder;
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Size of an element of a type
+ */
+static size_t SDAQ_func_fileElemSize(int type)
+{
+    return (type == SDAQ_CONST_TYPE_SHORT) ? sizeof(short) : sizeof(double);
+}
+
+/**
+ * Round up to the alignment
+ */
+static uint64_t SDAQ_func_fileAlign(uint64_t offset)
+{
+    return (offset + SDAQ_CONST_FILE_ALIGN - 1) / SDAQ_CONST_FILE_ALIGN * SDAQ_CONST_FILE_ALIGN;
+}
+
+/**
+ * Fill the header and the directory according to the layout
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
+ */
+static int SDAQ_func_fileBuildHeader(SDAQ_struc_fileHeader *header, SDAQ_struc_fileChannel *dir, int layout,
+                                     const SDAQ_struc_fileSource *src, int chNum, unsigned long pulseNum)
+{
+    int      i;
+    uint64_t var_offset;
+    uint64_t var_chBytes;
+
+    memset((void *)header, 0, sizeof(SDAQ_struc_fileHeader));
+    memset((void *)dir,    0, sizeof(SDAQ_struc_fileChannel) * chNum);
+
+    memcpy(header -> magic, SDAQ_CONST_FILE_MAGIC, sizeof(header -> magic));
+    header -> version      = SDAQ_CONST_FILE_VERSION;
+    header -> headerSize   = sizeof(SDAQ_struc_fileHeader);
+    header -> layout       = (uint32_t)layout;
+    header -> channelNum   = (uint32_t)chNum;
+    header -> pulseNum     = pulseNum;
+    header -> dirOffset    = sizeof(SDAQ_struc_fileHeader);
+    header -> dataOffset   = SDAQ_func_fileAlign(header -> dirOffset + sizeof(SDAQ_struc_fileChannel) * chNum);
+    header -> createTime_s = (double)time(NULL);
+
+    var_offset = (layout == SDAQ_CONST_LAYOUT_CHANNEL_MAJOR) ? header -> dataOffset : 0;
+
+    for(i = 0; i < chNum; i ++) {
+        if(src[i].pno <= 0) return -1;
+
+        if(src[i].name) strncpy(dir[i].name, src[i].name, SDAQ_CONST_CH_NAME_LEN - 1);
+
+        dir[i].codec  = SDAQ_CONST_CODEC_NONE;
+        dir[i].type   = (uint32_t)src[i].type;
+        dir[i].pno    = (uint32_t)src[i].pno;
+        dir[i].scale  = src[i].scale;
+        dir[i].offset = src[i].offset;
+
+        var_chBytes   = SDAQ_func_fileElemSize(src[i].type) * src[i].pno;
+
+        if(layout == SDAQ_CONST_LAYOUT_CHANNEL_MAJOR) {
+            dir[i].dataOffset = var_offset;
+            dir[i].dataBytes  = var_chBytes * pulseNum;
+            dir[i].rawBytes   = dir[i].dataBytes;
+            var_offset        = SDAQ_func_fileAlign(var_offset + dir[i].dataBytes);
+        } else {
+            dir[i].dataOffset = var_offset;
+            dir[i].dataBytes  = var_chBytes;
+            dir[i].rawBytes   = var_chBytes;
+            var_offset       += var_chBytes;
+        }
+    }
+
+    header -> pulseBytes = (layout == SDAQ_CONST_LAYOUT_PULSE_MAJOR) ? var_offset : 0;
+
+    return 0;
+}
+
+/**
+ * Write the header and the directory
+ */
+static int SDAQ_func_fileWriteHeader(FILE *file, SDAQ_struc_fileHeader *header, SDAQ_struc_fileChannel *dir)
+{
+    if(fwrite((void *)header, sizeof(SDAQ_struc_fileHeader), 1, file) != 1) return -1;
+    if(header -> channelNum > 0 && fwrite((void *)dir, sizeof(SDAQ_struc_fileChannel), header -> channelNum, file) != header -> channelNum) return -1;
+
+    return 0;
+}
+
+/**
+ * Get the address of the pulse p of a channel
+ */
+static const char *SDAQ_func_fileGetPulse(const SDAQ_struc_fileSource *src, unsigned long firstPulse, unsigned long p, unsigned long ringPulseNum)
+{
+    return (const char *)src -> data + ((firstPulse + p) % ringPulseNum) * src -> pulseStride * SDAQ_func_fileElemSize(src -> type);
+}
+
+/**
+ * Get the monotonic time in s
+ */
+static double SDAQ_func_fileGetTime_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Code the block in the coder and append it to the file
+ */
+static int SDAQ_func_filePutBlock(FILE *file, SDAQ_struc_fileCoder *coder, const SDAQ_struc_fileSource *src, 
+                                  size_t rawBytes, uint64_t *fileBytes, SDAQ_struc_fileStat *stat)
+{
+    double   var_time_s = SDAQ_func_fileGetTime_s();
+    size_t   var_size;
+    uint32_t var_blockSize;
+
+    var_size = SDAQ_func_codecEncode(&coder -> codec, (int)SDAQ_func_fileElemSize(src -> type), src -> type == SDAQ_CONST_TYPE_SHORT, 
+                                     coder -> raw, rawBytes, coder -> out);
+
+    if(stat) stat -> codecTime_s += SDAQ_func_fileGetTime_s() - var_time_s;
+
+    var_blockSize = var_size ? (uint32_t)var_size : ((uint32_t)rawBytes | SDAQ_CONST_BLOCK_STORED);
+
+    if(fwrite((void *)&var_blockSize, sizeof(uint32_t), 1, file) != 1) return -1;
+    if(fwrite(var_size ? (void *)coder -> out : (void *)coder -> raw, 1, var_size ? var_size : rawBytes, file) != (var_size ? var_size : rawBytes)) return -1;
+
+    *fileBytes += sizeof(uint32_t) + (var_size ? var_size : rawBytes);
+
+    return 0;
+}
+
+/**
+ * Write a channel compressed (channel-major layout), the size in the directory entry is updated
+ */
+static int SDAQ_func_fileWriteCoded(FILE *file, SDAQ_struc_fileCoder *coder, const SDAQ_struc_fileSource *src, SDAQ_struc_fileChannel *dir,
+                                    unsigned long firstPulse, unsigned long pulseNum, unsigned long ringPulseNum, SDAQ_struc_fileStat *stat)
+{
+    const char *ptr_pulse;
+    size_t   var_pulseBytes = SDAQ_func_fileElemSize(src -> type) * src -> pno;
+    size_t   var_fill       = 0;
+    size_t   var_pos;
+    size_t   var_copy;
+    uint64_t var_fileBytes  = 0;
+    unsigned long p;
+
+    /* gather the pulses into blocks (a block is a multiple of the element size) */
+    for(p = 0; p < pulseNum; p ++) {
+        ptr_pulse = SDAQ_func_fileGetPulse(src, firstPulse, p, ringPulseNum);
+
+        for(var_pos = 0; var_pos < var_pulseBytes; var_pos += var_copy) {
+            var_copy = var_pulseBytes - var_pos;
+            if(var_copy > SDAQ_CONST_CODEC_BLOCK_SIZE - var_fill) var_copy = SDAQ_CONST_CODEC_BLOCK_SIZE - var_fill;
+
+            memcpy((void *)(coder -> raw + var_fill), (const void *)(ptr_pulse + var_pos), var_copy);
+            var_fill += var_copy;
+
+            if(var_fill == SDAQ_CONST_CODEC_BLOCK_SIZE) {
+                if(SDAQ_func_filePutBlock(file, coder, src, var_fill, &var_fileBytes, stat) != 0) return -1;
+                var_fill = 0;
+            }
+        }
+    }
+
+    if(var_fill > 0 && SDAQ_func_filePutBlock(file, coder, src, var_fill, &var_fileBytes, stat) != 0) return -1;
+
+    dir -> codec      = SDAQ_CONST_CODEC_SHUFFLE_LZ;
+    dir -> blockBytes = SDAQ_CONST_CODEC_BLOCK_SIZE;
+    dir -> dataBytes  = var_fileBytes;
+
+    return 0;
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Write the channels to a file
+ * Input:
+ *     fileName         : Name of the file
+ *     layout           : SDAQ_CONST_LAYOUT_xxx
+ *     codec            : SDAQ_CONST_CODEC_xxx, only used for the channel-major layout
+ *     src              : Sources of the channels
+ *     chNum            : Number of channels
+ *     firstPulse       : Position of the first (oldest) pulse in the sources
+ *     pulseNum         : Number of pulses to be written
+ *     ringPulseNum     : Number of pulses in the sources (circular buffer), use pulseNum for linear buffers
+ *     percent          : Progress of the writing, can be NULL
+ *     stat             : Statistics of the writing, can be NULL
+ * Return:
+ *     0                : Successful
+ *    -1                : Failed
+ */
+int SDAQ_func_fileWrite(const char *fileName, int layout, int codec, const SDAQ_struc_fileSource *src, int chNum, 
+                        unsigned long firstPulse, unsigned long pulseNum, unsigned long ringPulseNum, 
+                        volatile long *percent, SDAQ_struc_fileStat *stat)
+{
+    FILE *file = NULL;
+    SDAQ_struc_fileHeader   var_header;
+    SDAQ_struc_fileChannel *ptr_dir   = NULL;
+    SDAQ_struc_fileCoder   *ptr_coder = NULL;
+    uint64_t var_offset;
+    size_t var_elemSize;
+    unsigned long p;
+    int i;
+    int status = 0;
+
+    if(!fileName || !fileName[0] || chNum < 0 || (chNum > 0 && !src) || ringPulseNum < pulseNum || ringPulseNum == 0) return -1;
+
+    if(stat) memset((void *)stat, 0, sizeof(SDAQ_struc_fileStat));
+
+    ptr_dir = (SDAQ_struc_fileChannel *)calloc(chNum > 0 ? chNum : 1, sizeof(SDAQ_struc_fileChannel));
+    if(!ptr_dir) return -1;
+
+    if(SDAQ_func_fileBuildHeader(&var_header, ptr_dir, layout, src, chNum, pulseNum) != 0) {
+        free(ptr_dir);
+        return -1;
+    }
+
+    /* working memory of the compression, write raw if not available */
+    if(codec != SDAQ_CONST_CODEC_NONE && layout == SDAQ_CONST_LAYOUT_CHANNEL_MAJOR) {
+        ptr_coder = (SDAQ_struc_fileCoder *)malloc(sizeof(SDAQ_struc_fileCoder));
+        if(!ptr_coder) EPICSLIB_func_errlogPrintf("SDAQ_func_fileWrite: No memory for the compression, write %s uncompressed\n", fileName);
+    }
+
+    file = fopen(fileName, "w");
+
+    if(!file) {
+        EPICSLIB_func_errlogPrintf("SDAQ_func_fileWrite: Failed to open the file %s\n", fileName);
+        free(ptr_coder);
+        free(ptr_dir);
+        return -1;
+    }
+
+    status += SDAQ_func_fileWriteHeader(file, &var_header, ptr_dir);
+
+    if(layout == SDAQ_CONST_LAYOUT_CHANNEL_MAJOR) {
+        var_offset = var_header.dataOffset;
+
+        for(i = 0; i < chNum && status == 0; i ++) {
+            var_elemSize = SDAQ_func_fileElemSize(src[i].type);
+
+            /* the compressed channels are placed one after another (page-aligned) when their sizes are known */
+            ptr_dir[i].dataOffset = var_offset;
+
+            if(fseek(file, (long)ptr_dir[i].dataOffset, SEEK_SET) != 0) { status = -1; break; }
+
+            if(ptr_coder) {
+                status = SDAQ_func_fileWriteCoded(file, ptr_coder, &src[i], &ptr_dir[i], firstPulse, pulseNum, ringPulseNum, stat);
+            } else if(src[i].pulseStride == src[i].pno && firstPulse + pulseNum <= ringPulseNum) {
+                /* linear buffer without gaps between pulses, write at once */
+                if(fwrite(SDAQ_func_fileGetPulse(&src[i], firstPulse, 0, ringPulseNum), var_elemSize * src[i].pno, pulseNum, file) != pulseNum) status = -1;
+            } else {
+                for(p = 0; p < pulseNum && status == 0; p ++)
+                    if(fwrite(SDAQ_func_fileGetPulse(&src[i], firstPulse, p, ringPulseNum), var_elemSize, src[i].pno, file) != (size_t)src[i].pno) status = -1;
+            }
+
+            var_offset = SDAQ_func_fileAlign(var_offset + ptr_dir[i].dataBytes);
+
+            if(stat) {
+                stat -> rawBytes  += (double)ptr_dir[i].rawBytes;
+                stat -> fileBytes += (double)ptr_dir[i].dataBytes;
+            }
+
+            if(percent) *percent = (long)((i + 1) * 100 / chNum);
+        }
+
+        /* update the directory with the real sizes */
+        if(ptr_coder && status == 0) {
+            if(fseek(file, (long)var_header.dirOffset, SEEK_SET) != 0 ||
+               fwrite((void *)ptr_dir, sizeof(SDAQ_struc_fileChannel), chNum, file) != (size_t)chNum) status = -1;
+        }
+    } else {
+        if(fseek(file, (long)var_header.dataOffset, SEEK_SET) != 0) status = -1;
+
+        for(p = 0; p < pulseNum && status == 0; p ++) {
+            for(i = 0; i < chNum && status == 0; i ++) {
+                var_elemSize = SDAQ_func_fileElemSize(src[i].type);
+                if(fwrite(SDAQ_func_fileGetPulse(&src[i], firstPulse, p, ringPulseNum), var_elemSize, src[i].pno, file) != (size_t)src[i].pno) status = -1;
+            }
+
+            if(percent) *percent = (long)((p + 1) * 100 / pulseNum);
+        }
+
+        if(stat) stat -> rawBytes = stat -> fileBytes = (double)var_header.pulseBytes * pulseNum;
+    }
+
+    if(fflush(file) != 0) status = -1;
+    fclose(file);
+    free(ptr_coder);
+    free(ptr_dir);
+
+    if(status != 0) EPICSLIB_func_errlogPrintf("SDAQ_func_fileWrite: Failed to write the file %s\n", fileName);
+
+    return status;
+}
+
+/**
+ * Open a pulse-major file whose pulse records will be appended by the caller (streaming). The pulse number
+ *   in the header is updated by the caller with SDAQ_func_fileUpdateStream while the file is written, and
+ *   finally by SDAQ_func_fileCloseStream. A reader of an open file may find more records than pulseNum
+ * Return:
+ *     NULL             : Failed
+ *     file             : Successful, positioned at the first pulse record
+ */
+FILE *SDAQ_func_fileOpenStream(const char *fileName, const SDAQ_struc_fileSource *src, int chNum)
+{
+    FILE *file = NULL;
+    SDAQ_struc_fileHeader   var_header;
+    SDAQ_struc_fileChannel *ptr_dir = NULL;
+
+    if(!fileName || !fileName[0] || chNum <= 0 || !src) return NULL;
+
+    ptr_dir = (SDAQ_struc_fileChannel *)calloc(chNum, sizeof(SDAQ_struc_fileChannel));
+    if(!ptr_dir) return NULL;
+
+    if(SDAQ_func_fileBuildHeader(&var_header, ptr_dir, SDAQ_CONST_LAYOUT_PULSE_MAJOR, src, chNum, 0) == 0 && (file = fopen(fileName, "w")) != NULL) {
+        if(SDAQ_func_fileWriteHeader(file, &var_header, ptr_dir) != 0 || fseek(file, (long)var_header.dataOffset, SEEK_SET) != 0) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    free(ptr_dir);
+
+    return file;
+}
+
+/**
+ * Write the pulse number of the records written so far into the header, and go back to the end of the file
+ *   for the next records
+ */
+int SDAQ_func_fileUpdateStream(FILE *file, unsigned long pulseNum)
+{
+    uint64_t var_pulseNum = pulseNum;
+
+    if(!file) return -1;
+
+    if(fseek(file, (long)offsetof(SDAQ_struc_fileHeader, pulseNum), SEEK_SET) != 0 ||
+       fwrite((void *)&var_pulseNum, sizeof(uint64_t), 1, file) != 1 ||
+       fseek(file, 0, SEEK_END) != 0) return -1;
+
+    return 0;
+}
+
+/**
+ * Write the final pulse number into the header and close the file
+ */
+int SDAQ_func_fileCloseStream(FILE *file, unsigned long pulseNum)
+{
+    int status;
+
+    if(!file) return -1;
+
+    status = SDAQ_func_fileUpdateStream(file, pulseNum);
+
+    fclose(file);
+
+    return status;
+}
+
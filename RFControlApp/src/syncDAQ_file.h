@@ -0,0 +1,120 @@
+/****************************************************
+ * syncDAQ_file.h
+ * 
+ * Header file for the file format of the synchronized data aquisition. 
+ *   The files are self-describing and can be memory mapped by the analysis tools:
+ *     - fixed header      : magic "SDAQFILE", version, layout, channel number, pulse number, offsets
+ *     - channel directory : name, type, point number per pulse, scale, offset and location of each channel
+ *     - data              : starting at a page-aligned offset, either
+ *                             channel-major: one page-aligned array per channel (pulse after pulse), or
+ *                             pulse-major  : one record per pulse with all channels (pulseBytes each)
+ *   In the channel-major layout, the channels can be compressed (see syncDAQ_codec.h). The array of a 
+ *   compressed channel is a sequence of blocks, each with a uint32 size followed by the coded data. The blocks
+ *   hold blockBytes raw bytes each (less for the last one), if bit 31 of the size is set the block is stored raw
+ *   All values are in the byte order of the IOC host (little endian for x86)
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef SYNC_DAQ_FILE_H
+#define SYNC_DAQ_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "syncDAQ_codec.h"
+
+#define SDAQ_CONST_FILE_MAGIC           "SDAQFILE"
+#define SDAQ_CONST_FILE_VERSION         1
+#define SDAQ_CONST_FILE_ALIGN           4096                /* alignment of the data, so one channel can be mapped alone */
+
+#define SDAQ_CONST_CH_NAME_LEN          48
+
+#define SDAQ_CONST_LAYOUT_CHANNEL_MAJOR 0                   /* layout of the data in the file */
+#define SDAQ_CONST_LAYOUT_PULSE_MAJOR   1
+
+#define SDAQ_CONST_TYPE_DOUBLE          1                   /* data type of the channels */
+#define SDAQ_CONST_TYPE_SHORT           2
+#define SDAQ_CONST_TYPE_UINT64          3                   /* pulse counter and timestamp */
+
+#define SDAQ_CONST_BLOCK_STORED         0x80000000u         /* flag in the block size of a compressed channel */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Data structure
+ *======================================*/
+/**
+ * Fixed header at the beginning of the file (64 bytes, no padding)
+ */
+typedef struct {
+    char     magic[8];                                      /* SDAQ_CONST_FILE_MAGIC without the terminating 0 */
+    uint32_t version;
+    uint32_t headerSize;                                    /* size of this header */
+    uint32_t layout;                                        /* SDAQ_CONST_LAYOUT_xxx */
+    uint32_t channelNum;                                    /* number of entries in the directory */
+    uint64_t pulseNum;                                      /* number of pulses in the file */
+    uint64_t dirOffset;                                     /* offset of the channel directory */
+    uint64_t dataOffset;                                    /* offset of the data (page aligned) */
+    uint64_t pulseBytes;                                    /* size of a pulse record (pulse-major layout) */
+    double   createTime_s;                                  /* creation time, seconds since 1970 */
+} SDAQ_struc_fileHeader;
+
+/**
+ * Entry of the channel directory (104 bytes, no padding)
+ */
+typedef struct {
+    char     name[SDAQ_CONST_CH_NAME_LEN];
+    uint32_t type;                                          /* SDAQ_CONST_TYPE_xxx */
+    uint32_t pno;                                           /* points per pulse */
+    double   scale;                                         /* physical value = raw * scale + offset */
+    double   offset;
+    uint64_t dataOffset;                                    /* channel-major: offset of the channel array in the file; pulse-major: offset in the pulse record */
+    uint64_t dataBytes;                                     /* channel-major: size of the channel array; pulse-major: size in the pulse record */
+    uint32_t codec;                                         /* SDAQ_CONST_CODEC_xxx */
+    uint32_t blockBytes;                                    /* raw bytes per block of a compressed channel */
+    uint64_t rawBytes;                                      /* size of the channel array before compression */
+} SDAQ_struc_fileChannel;
+
+/**
+ * Source of a channel to be written. The point k of pulse p is at 
+ *   data + ((firstPulse + p) % ringPulseNum) * pulseStride + k (in elements)
+ */
+typedef struct {
+    const char *name;
+    int         type;                                       /* SDAQ_CONST_TYPE_xxx */
+    int         pno;
+    double      scale;
+    double      offset;
+    const void *data;
+    long        pulseStride;                                /* elements between two pulses */
+} SDAQ_struc_fileSource;
+
+/**
+ * Statistics of writing a file
+ */
+typedef struct {
+    double rawBytes;                                        /* size of the data before compression */
+    double fileBytes;                                       /* size of the data in the file */
+    double codecTime_s;                                     /* time spent in the compression */
+} SDAQ_struc_fileStat;
+
+/*======================================
+ * Routines
+ *======================================*/     
+int SDAQ_func_fileWrite(const char *fileName, int layout, int codec, const SDAQ_struc_fileSource *src, int chNum, 
+                        unsigned long firstPulse, unsigned long pulseNum, unsigned long ringPulseNum, 
+                        volatile long *percent, SDAQ_struc_fileStat *stat);
+
+FILE *SDAQ_func_fileOpenStream(const char *fileName, const SDAQ_struc_fileSource *src, int chNum);     /* pulse-major file with records appended later */
+int   SDAQ_func_fileUpdateStream(FILE *file, unsigned long pulseNum);                                 /* update the pulse number, the file stays open */
+int   SDAQ_func_fileCloseStream(FILE *file, unsigned long pulseNum);                                  /* update the pulse number and close */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,319 @@
+/****************************************************
+ * syncDAQ_pool.c
+ * 
+ * Source file for the buffer pool of the synchronized data aquisition. 
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <epicsMutex.h>
+
+#include "EPICSLib_wrapper.h"
+#include "syncDAQ_pool.h"
+
+/*======================================
+ * Private Data
+ *======================================*/
+typedef struct SDAQ_struc_poolBlock {
+    struct SDAQ_struc_poolBlock *next;                      /* stored in the free block itself */
+    size_t size;                                            /* size of the allocation, only for the blocks given back later */
+} SDAQ_struc_poolBlock;
+
+static SDAQ_struc_poolBlock *SDAQ_gvar_poolFreeList[SDAQ_CONST_POOL_CLASS_NUM];
+static SDAQ_struc_poolBlock * volatile SDAQ_gvar_poolLaterList = NULL;     /* blocks given back by the real-time threads, not cleared yet */
+
+static int          SDAQ_gvar_poolBlockNum[SDAQ_CONST_POOL_CLASS_NUM];     /* blocks mapped in each size class (free or used) */
+static int          SDAQ_gvar_poolReserved[SDAQ_CONST_POOL_CLASS_NUM];     /* blocks reserved in each size class */
+
+static epicsMutexId SDAQ_gvar_poolMutex     = NULL;
+static int          SDAQ_gvar_poolHugePage  = 0;
+
+static size_t       SDAQ_gvar_poolUsedBytes = 0;
+static size_t       SDAQ_gvar_poolFreeBytes = 0;
+
+/*======================================
+ * Private Routines
+ *======================================*/
+/**
+ * Get the size class of a block
+ * Return:
+ *     class id         : Successful
+ *    -1                : Too large
+ */
+static int SDAQ_func_poolGetClass(size_t size)
+{
+    int var_classId = 0;
+
+    while(((size_t)1 << (var_classId + SDAQ_CONST_POOL_MIN_SHIFT)) < size) {
+        var_classId ++;
+        if(var_classId >= SDAQ_CONST_POOL_CLASS_NUM) return -1;
+    }
+
+    return var_classId;
+}
+
+/**
+ * Get new memory from the OS, the content is zero
+ */
+static void *SDAQ_func_poolMap(size_t size)
+{
+#ifdef __linux__
+    void *ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if(SDAQ_gvar_poolHugePage && size >= SDAQ_CONST_POOL_HUGE_PAGE_SIZE)
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if(ptr == MAP_FAILED)                                   /* no huge pages reserved, use the normal pages */
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+#else
+    return calloc(1, size);
+#endif
+}
+
+/*======================================
+ * Public Routines
+ *======================================*/
+/**
+ * Init the pool, should be called before the threads using the pool are started
+ */
+int SDAQ_func_poolInit(void)
+{
+    if(SDAQ_gvar_poolMutex) return 0;
+
+    SDAQ_gvar_poolMutex = epicsMutexCreate();
+
+    return SDAQ_gvar_poolMutex ? 0 : -1;
+}
+
+/**
+ * Get a block with at least size bytes from the pool. The content is zero
+ * Return:
+ *     NULL             : Failed
+ *     block address    : Successful
+ */
+void *SDAQ_func_poolAlloc(size_t size)
+{
+    int    var_classId;
+    size_t var_classSize;
+    void  *ptr = NULL;
+
+    if(!SDAQ_gvar_poolMutex || size == 0) return NULL;
+
+    var_classId = SDAQ_func_poolGetClass(size);
+    if(var_classId < 0) return NULL;
+
+    var_classSize = (size_t)1 << (var_classId + SDAQ_CONST_POOL_MIN_SHIFT);
+
+    epicsMutexLock(SDAQ_gvar_poolMutex);
+
+    if(SDAQ_gvar_poolFreeList[var_classId]) {
+        ptr = (void *)SDAQ_gvar_poolFreeList[var_classId];
+        SDAQ_gvar_poolFreeList[var_classId] = SDAQ_gvar_poolFreeList[var_classId] -> next;
+        ((SDAQ_struc_poolBlock *)ptr) -> next = NULL;       /* the link was the only non-zero content */
+        SDAQ_gvar_poolFreeBytes -= var_classSize;
+    }
+
+    epicsMutexUnlock(SDAQ_gvar_poolMutex);
+
+    if(!ptr) {
+        ptr = SDAQ_func_poolMap(var_classSize);             /* fresh pages from the OS are zero */
+
+        if(ptr) {
+            epicsMutexLock(SDAQ_gvar_poolMutex);
+            SDAQ_gvar_poolBlockNum[var_classId] ++;
+            epicsMutexUnlock(SDAQ_gvar_poolMutex);
+        }
+    }
+
+    if(ptr) {
+        epicsMutexLock(SDAQ_gvar_poolMutex);
+        SDAQ_gvar_poolUsedBytes += var_classSize;
+        epicsMutexUnlock(SDAQ_gvar_poolMutex);
+    }
+
+    return ptr;
+}
+
+/**
+ * Give the block back to the pool, it will be reused by the next allocation of the same size class. The
+ *   block is cleared here, so this should be called by a background thread (e.g. the writer)
+ */
+void SDAQ_func_poolFree(void *ptr, size_t size)
+{
+    int    var_classId;
+    size_t var_classSize;
+    SDAQ_struc_poolBlock *ptr_block = (SDAQ_struc_poolBlock *)ptr;
+
+    if(!SDAQ_gvar_poolMutex || !ptr) return;
+
+    var_classId = SDAQ_func_poolGetClass(size);
+    if(var_classId < 0) return;
+
+    var_classSize = (size_t)1 << (var_classId + SDAQ_CONST_POOL_MIN_SHIFT);
+
+    if(size < sizeof(SDAQ_struc_poolBlock)) size = sizeof(SDAQ_struc_poolBlock);  /* the link and the size stored by SDAQ_func_poolFreeLater */
+
+    memset(ptr, 0, size);                                   /* blocks in the pool are always zero, so the allocation does not need to clear */
+
+    epicsMutexLock(SDAQ_gvar_poolMutex);
+
+    ptr_block -> next = SDAQ_gvar_poolFreeList[var_classId];
+    SDAQ_gvar_poolFreeList[var_classId] = ptr_block;
+
+    SDAQ_gvar_poolUsedBytes -= var_classSize;
+    SDAQ_gvar_poolFreeBytes += var_classSize;
+
+    epicsMutexUnlock(SDAQ_gvar_poolMutex);
+}
+
+/**
+ * Give the block back to the pool without clearing it, can be called by the real-time threads. The block is
+ *   only linked into a list here (lock-free), it is cleared and put into the pool by the next SDAQ_func_poolCollect
+ */
+void SDAQ_func_poolFreeLater(void *ptr, size_t size)
+{
+    SDAQ_struc_poolBlock *ptr_block = (SDAQ_struc_poolBlock *)ptr;
+    SDAQ_struc_poolBlock *var_head;
+
+    if(!ptr) return;
+
+    ptr_block -> size = size;
+
+    do {
+        var_head          = SDAQ_gvar_poolLaterList;
+        ptr_block -> next = var_head;
+    } while(!__sync_bool_compare_and_swap(&SDAQ_gvar_poolLaterList, var_head, ptr_block));
+}
+
+/**
+ * Clear the blocks given back by SDAQ_func_poolFreeLater and put them into the pool, called by the background
+ *   threads (e.g. the writers). The whole list is taken at once, so there is no ABA problem with the producers
+ */
+void SDAQ_func_poolCollect(void)
+{
+    SDAQ_struc_poolBlock *ptr_block = (SDAQ_struc_poolBlock *)__sync_lock_test_and_set(&SDAQ_gvar_poolLaterList, NULL);
+    SDAQ_struc_poolBlock *ptr_next;
+
+    __sync_synchronize();
+
+    while(ptr_block) {
+        ptr_next = ptr_block -> next;
+        SDAQ_func_poolFree((void *)ptr_block, ptr_block -> size);
+        ptr_block = ptr_next;
+    }
+}
+
+/**
+ * Reserve blocks in the pool, so that the allocations of a capture do not map new memory. The missing blocks
+ *   are mapped and touched here, the reservation is added to the ones of the other captures and sessions.
+ *   The blocks stay in the pool when the reservation is dropped (negative num), they are reused by the later
+ *   reservations. Should not be called by the real-time threads
+ * Return:
+ *     0                : Successful
+ *    -1                : Too large or no memory
+ */
+int SDAQ_func_poolReserve(size_t size, int num)
+{
+    int    var_classId;
+    int    var_missing;
+    size_t var_classSize;
+    size_t j;
+    void  *ptr;
+    volatile char *ptr_byte;
+
+    if(!SDAQ_gvar_poolMutex || size == 0 || num == 0) return 0;
+
+    var_classId = SDAQ_func_poolGetClass(size);
+    if(var_classId < 0) return -1;
+
+    var_classSize = (size_t)1 << (var_classId + SDAQ_CONST_POOL_MIN_SHIFT);
+
+    /* claim the blocks to be mapped, so that the concurrent reservations do not map them again */
+    epicsMutexLock(SDAQ_gvar_poolMutex);
+
+    SDAQ_gvar_poolReserved[var_classId] += num;
+    if(SDAQ_gvar_poolReserved[var_classId] < 0) SDAQ_gvar_poolReserved[var_classId] = 0;
+
+    var_missing = SDAQ_gvar_poolReserved[var_classId] - SDAQ_gvar_poolBlockNum[var_classId];
+    if(var_missing > 0) SDAQ_gvar_poolBlockNum[var_classId] += var_missing;
+
+    epicsMutexUnlock(SDAQ_gvar_poolMutex);
+
+    /* map and touch the new blocks outside of the lock, the allocations are not blocked */
+    for(; var_missing > 0; var_missing --) {
+        ptr = SDAQ_func_poolMap(var_classSize);
+
+        if(!ptr) {
+            epicsMutexLock(SDAQ_gvar_poolMutex);
+            SDAQ_gvar_poolBlockNum[var_classId] -= var_missing;
+            epicsMutexUnlock(SDAQ_gvar_poolMutex);
+            return -1;
+        }
+
+        ptr_byte = (volatile char *)ptr;
+        for(j = 0; j < var_classSize; j += 4096)
+            __sync_fetch_and_add(ptr_byte + j, 0);
+
+        epicsMutexLock(SDAQ_gvar_poolMutex);
+        ((SDAQ_struc_poolBlock *)ptr) -> next = SDAQ_gvar_poolFreeList[var_classId];
+        SDAQ_gvar_poolFreeList[var_classId]   = (SDAQ_struc_poolBlock *)ptr;
+        SDAQ_gvar_poolFreeBytes += var_classSize;
+        epicsMutexUnlock(SDAQ_gvar_poolMutex);
+    }
+
+    return 0;
+}
+
+/**
+ * Enable or disable the huge pages for the new blocks (the blocks already in the pool are not changed)
+ */
+void SDAQ_func_poolSetHugePage(int enable)
+{
+    SDAQ_gvar_poolHugePage = enable ? 1 : 0;
+}
+
+/**
+ * Touch every page of the free blocks, so that the next capture does not see page faults
+ */
+void SDAQ_func_poolPrefault(void)
+{
+    int    i;
+    size_t j;
+    SDAQ_struc_poolBlock *ptr_block;
+    volatile char        *ptr_byte;
+
+    if(!SDAQ_gvar_poolMutex) return;
+
+    epicsMutexLock(SDAQ_gvar_poolMutex);
+
+    for(i = 0; i < SDAQ_CONST_POOL_CLASS_NUM; i ++) {
+        for(ptr_block = SDAQ_gvar_poolFreeList[i]; ptr_block; ptr_block = ptr_block -> next) {
+            ptr_byte = (volatile char *)ptr_block;
+            for(j = 0; j < ((size_t)1 << (i + SDAQ_CONST_POOL_MIN_SHIFT)); j += 4096)
+                __sync_fetch_and_add(ptr_byte + j, 0);
+        }
+    }
+
+    epicsMutexUnlock(SDAQ_gvar_poolMutex);
+}
+
+/**
+ * Get the memory held by the pool
+ */
+void SDAQ_func_poolGetStat(double *used_MB, double *free_MB)
+{
+    if(used_MB) *used_MB = SDAQ_gvar_poolUsedBytes / 1048576.0;
+    if(free_MB) *free_MB = SDAQ_gvar_poolFreeBytes / 1048576.0;
+}
+
@@ -0,0 +1,46 @@
+/****************************************************
+ * syncDAQ_pool.h
+ * 
+ * Header file for the buffer pool of the synchronized data aquisition. 
+ *   The capture buffers are only needed during a capture, so they are got from this pool when a capture
+ *   starts and given back when the file is written. The pool keeps the freed blocks in power of 2 size 
+ *   classes for the next capture (no page faults again), and can optionally use huge pages. The blocks 
+ *   needed by the configured captures can be reserved beforehand, so that the real-time thread starting
+ *   a capture never maps new memory. The real-time thread gives the blocks back with SDAQ_func_poolFreeLater,
+ *   they are cleared and put into the pool by a background thread calling SDAQ_func_poolCollect
+ *
+ * Created on: 2026.10.18
+ * Description: Initial creation
+ ****************************************************/
+#ifndef SYNC_DAQ_POOL_H
+#define SYNC_DAQ_POOL_H
+
+#include <stddef.h>
+
+#define SDAQ_CONST_POOL_MIN_SHIFT       12                  /* smallest size class, 4 KB */
+#define SDAQ_CONST_POOL_CLASS_NUM       16                  /* size classes from 4 KB to 128 MB */
+#define SDAQ_CONST_POOL_HUGE_PAGE_SIZE  (2UL * 1024 * 1024) /* blocks of this size or larger can use huge pages */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*======================================
+ * Routines
+ *======================================*/     
+int   SDAQ_func_poolInit(void);
+void *SDAQ_func_poolAlloc(size_t size);                     /* get a zeroed block of at least size bytes */
+void  SDAQ_func_poolFree(void *ptr, size_t size);           /* give back the block (cleared here), size should be the same as the allocation */
+void  SDAQ_func_poolFreeLater(void *ptr, size_t size);      /* give back the block without clearing it, lock-free, for the real-time threads */
+void  SDAQ_func_poolCollect(void);                          /* clear the blocks given back later and put them into the pool, for the background threads */
+int   SDAQ_func_poolReserve(size_t size, int num);          /* reserve num more blocks of at least size bytes (negative to drop a reservation) */
+void  SDAQ_func_poolSetHugePage(int enable);                /* 1 to try MAP_HUGETLB for the new large blocks */
+void  SDAQ_func_poolPrefault(void);                         /* touch every page of the free blocks */
+void  SDAQ_func_poolGetStat(double *used_MB, double *free_MB);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+